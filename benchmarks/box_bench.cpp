@@ -0,0 +1,71 @@
+// Layout throughput on a tree made only of Boxes and their items, no anchors and no wrapping
+// content, so the time goes to the Box solver.
+
+#include <frameflow/layout.hpp>
+#include <frameflow/layout_tape.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace frameflow;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// About a million nodes: rows of cells, each cell a vertical Box of a few lines
+static NodeId build_tree(System *sys, int rows, int cells, int lines) {
+    NodeId list = add_box(sys, NullNode, {Direction::Vertical, Align::Start});
+    for (int i = 0; i < rows; i++) {
+        NodeId row = add_box(sys, list, {Direction::Horizontal, i % 2 ? Align::SpaceBetween : Align::Start});
+        get_node(sys, row)->minimum_size = {1920, 60};
+        for (int j = 0; j < cells; j++) {
+            NodeId cell = add_box(sys, row, {Direction::Vertical, Align::Center});
+            get_node(sys, cell)->minimum_size = {60.f + static_cast<float>(j), 60};
+            get_node(sys, cell)->expand = {1, 0};
+            get_node(sys, cell)->stretch = {static_cast<float>(1 + j % 3), 1};
+            for (int k = 0; k < lines; k++) {
+                NodeId line = add_generic(sys, cell);
+                get_node(sys, line)->minimum_size = {40, 12};
+                get_node(sys, line)->expand = {0, k == 0 ? 1.f : 0.f};
+            }
+        }
+    }
+    get_node(sys, list)->bounds = {{0, 0}, {1920, 1080}};
+    return list;
+}
+
+int main() {
+    constexpr int Rows = 20000;
+    constexpr int Cells = 12;
+    constexpr int Lines = 3;
+    constexpr int Passes = 10;
+
+    System sys;
+    NodeId root = build_tree(&sys, Rows, Cells, Lines);
+    std::printf("nodes: %zu\n", sys.nodes.size());
+
+    compute_layout(&sys, root);
+    double best = 1e30;
+    for (int i = 0; i < Passes; i++) {
+        auto start = std::chrono::steady_clock::now();
+        compute_layout(&sys, root);
+        best = std::min(best, elapsed_ms(start));
+    }
+    std::printf("compute_layout: %.2f ms, %.1f M nodes/s\n", best,
+                static_cast<double>(sys.nodes.size()) / best / 1e3);
+
+    LayoutTape tape;
+    compile_layout(&sys, root, &tape);
+    run_layout_tape(&sys, &tape);
+    best = 1e30;
+    for (int i = 0; i < Passes; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run_layout_tape(&sys, &tape);
+        best = std::min(best, elapsed_ms(start));
+    }
+    std::printf("run_layout_tape: %.2f ms, %.1f M nodes/s (%zu ops)\n", best,
+                static_cast<double>(sys.nodes.size()) / best / 1e3, tape.ops.size());
+    return 0;
+}
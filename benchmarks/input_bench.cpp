@@ -0,0 +1,119 @@
+// Layout throughput on a large tree with the inputs stored as floats or as halves.
+// Built twice by benchmarks/CMakeLists.txt, frameflow_input_bench and
+// frameflow_input_bench_compact, run both to compare.
+
+#include <frameflow/half.hpp>
+#include <frameflow/layout.hpp>
+#include <frameflow/layout_simd.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace frameflow;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best of a number of passes, after one to warm up
+static double time_layout(System *sys, NodeId root, int passes) {
+    compute_layout(sys, root);
+    double best = 1e30;
+    for (int i = 0; i < passes; i++) {
+        auto start = std::chrono::steady_clock::now();
+        compute_layout(sys, root);
+        best = std::min(best, elapsed_ms(start));
+    }
+    return best;
+}
+
+// About a million nodes: rows of cells, each cell a margin around an anchored label
+static NodeId build_tree(System *sys, int rows, int cells) {
+    NodeId list = add_box(sys, NullNode, {Direction::Vertical, Align::Start});
+    for (int i = 0; i < rows; i++) {
+        NodeId row = add_box(sys, list, {Direction::Horizontal, Align::Start});
+        get_node(sys, row)->minimum_size = {200, 20};
+        get_node(sys, row)->expand = {1, 0};
+        for (int j = 0; j < cells; j++) {
+            NodeId cell = add_margin(sys, row, {2, 2, 2, 2});
+            get_node(sys, cell)->minimum_size = {20.f + static_cast<float>(j), 20};
+            get_node(sys, cell)->expand = {1, 1};
+            get_node(sys, cell)->stretch = {static_cast<float>(1 + j % 3), 1};
+            NodeId label = add_generic(sys, cell);
+            get_node(sys, label)->anchors = {0, 0, 1, 1};
+            get_node(sys, label)->offsets = {4, 2, -4, -2};
+        }
+    }
+    get_node(sys, list)->bounds = {{0, 0}, {1920, 1080}};
+    return list;
+}
+
+int main() {
+    constexpr int Rows = 40000;
+    constexpr int Cells = 12;
+    constexpr int Passes = 10;
+
+    System sys;
+    NodeId root = build_tree(&sys, Rows, Cells);
+
+    // Inputs as stored: minimum_size, expand, stretch, anchors and offsets
+    const size_t input_bytes = sizeof(Node::minimum_size) + sizeof(Node::expand) + sizeof(Node::stretch) +
+                               sizeof(Node::anchors) + sizeof(Node::offsets);
+    std::printf("inputs: %s, F16C: %s\n", FRAMEFLOW_COMPACT_INPUTS ? "half" : "float",
+#if defined(__F16C__)
+                "yes"
+#else
+                "no"
+#endif
+    );
+    std::printf("nodes: %zu, sizeof(Node): %zu, input bytes per node: %zu, node array: %.1f MB\n",
+                sys.nodes.size(), sizeof(Node), input_bytes,
+                static_cast<double>(sys.nodes.size() * sizeof(Node)) / 1e6);
+
+    double best = time_layout(&sys, root, Passes);
+    std::printf("compute_layout: %.2f ms, %.1f M nodes/s\n", best,
+                static_cast<double>(sys.nodes.size()) / best / 1e3);
+
+    // Height-for-width is only measured where a subtree wraps: a flow in the first cell makes
+    // its row and the list measure, the other cells' subtrees are still skipped
+    NodeId first_cell = get_node(&sys, get_node(&sys, root)->children[0])->children[0];
+    NodeId flow = add_flow(&sys, first_cell, {Direction::Horizontal, Align::Start});
+    for (int i = 0; i < 8; i++) get_node(&sys, add_generic(&sys, flow))->minimum_size = {12, 12};
+    best = time_layout(&sys, root, Passes);
+    std::printf("compute_layout, one wrapping cell: %.2f ms\n", best);
+
+    // Raw conversion throughput of each kernel variant against reading the same count of floats
+    constexpr size_t Count = size_t(1) << 24;
+    std::vector<uint16_t> halves(Count, float_to_half_bits(1.5f));
+    std::vector<float> floats(Count, 1.5f);
+    std::vector<float> out(Count);
+
+    double copy = 1e30;
+    for (int i = 0; i < Passes; i++) {
+        auto start = std::chrono::steady_clock::now();
+        std::copy(floats.begin(), floats.end(), out.begin());
+        copy = std::min(copy, elapsed_ms(start));
+    }
+    std::printf("float copy: %.2f ms (%.1f GB/s read)\n", copy,
+                static_cast<double>(Count * sizeof(float)) / copy / 1e6);
+
+    const Isa detected = detected_isa();
+    for (Isa isa: {Isa::Scalar, Isa::Sse4, Isa::Avx2, Isa::Avx512, Isa::Avx512Fp16}) {
+        if (!force_isa(isa)) continue;
+        double to_floats = 1e30, to_halves = 1e30;
+        for (int i = 0; i < Passes; i++) {
+            auto start = std::chrono::steady_clock::now();
+            halves_to_floats(halves.data(), out.data(), Count);
+            to_floats = std::min(to_floats, elapsed_ms(start));
+
+            start = std::chrono::steady_clock::now();
+            floats_to_halves(out.data(), halves.data(), Count);
+            to_halves = std::min(to_halves, elapsed_ms(start));
+        }
+        std::printf("%-10s halves_to_floats: %.2f ms (%.1f GB/s read), floats_to_halves: %.2f ms\n", isa_name(isa),
+                    to_floats, static_cast<double>(Count * sizeof(uint16_t)) / to_floats / 1e6, to_halves);
+    }
+    force_isa(detected);
+    return out[Count / 2] == 1.5f ? 0 : 1;
+}
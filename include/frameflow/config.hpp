@@ -0,0 +1,68 @@
+#pragma once
+
+// Compile-time feature configuration.
+// Every option defaults to enabled; the CMake options of the same name set them for the
+// library and its users. Disabled node types lose their add_* functions, component pools
+// and solvers; disabled node inputs are removed from Node and treated as their defaults.
+
+// Node types, Generic is always available
+#ifndef FRAMEFLOW_ENABLE_CENTER
+#define FRAMEFLOW_ENABLE_CENTER 1
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_BOX
+#define FRAMEFLOW_ENABLE_BOX 1
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_FLOW
+#define FRAMEFLOW_ENABLE_FLOW 1
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_MARGIN
+#define FRAMEFLOW_ENABLE_MARGIN 1
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_STACK
+#define FRAMEFLOW_ENABLE_STACK 1
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_MASONRY
+#define FRAMEFLOW_ENABLE_MASONRY 1
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_EMBED
+#define FRAMEFLOW_ENABLE_EMBED 1
+#endif
+
+// Node inputs
+#ifndef FRAMEFLOW_ENABLE_ANCHORS
+#define FRAMEFLOW_ENABLE_ANCHORS 1 // Node::anchors and Node::offsets
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_EXPAND
+#define FRAMEFLOW_ENABLE_EXPAND 1  // Node::expand and Node::stretch
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_RELATIVE_SIZE
+#define FRAMEFLOW_ENABLE_RELATIVE_SIZE 1 // Node::percent_size and Node::aspect_ratio
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_BREAKPOINTS
+#define FRAMEFLOW_ENABLE_BREAKPOINTS 1 // Node::breakpoint_index and the *_breakpoint functions
+#endif
+
+// Node outputs and bookkeeping
+#ifndef FRAMEFLOW_ENABLE_CONTENT_EXTENT
+#define FRAMEFLOW_ENABLE_CONTENT_EXTENT 1 // Node::content_extent and Node::overflow
+#endif
+
+#ifndef FRAMEFLOW_ENABLE_FLAGS
+#define FRAMEFLOW_ENABLE_FLAGS 1 // Node::flags and Node::subtree_flags, find_nodes and hit_test
+#endif
+
+// Storage
+#ifndef FRAMEFLOW_COMPACT_INPUTS
+// Store node inputs (minimum_size, expand, stretch, anchors, offsets) as half floats,
+// see frameflow/half.hpp. Off by default, values beyond integers up to 2048 lose precision.
+#define FRAMEFLOW_COMPACT_INPUTS 0
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+// IEEE 754 half-precision floats, the storage of node inputs with FRAMEFLOW_COMPACT_INPUTS.
+// Built with F16C (-mf16c, -march=haswell or later) conversions are single instructions,
+// otherwise they are done on the bits, rounding to nearest even like the hardware.
+// Halves hold integers exactly up to 2048 and keep 11 significant bits above that.
+
+namespace frameflow {
+    inline uint16_t float_to_half_bits(float value) {
+#if defined(__F16C__)
+        return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+        uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+        const uint32_t sign = (f >> 16) & 0x8000;
+        f &= 0x7fffffff;
+
+        // NaNs keep the top of their payload and become quiet, as in F16C
+        if (f > 0x7f800000) return static_cast<uint16_t>(sign | 0x7e00 | ((f >> 13) & 0x3ff));
+        if (f == 0x7f800000) return static_cast<uint16_t>(sign | 0x7c00);
+        if (f >= 0x477ff000) return static_cast<uint16_t>(sign | 0x7c00); // Rounds past 65504
+        if (f <= 0x33000000) return static_cast<uint16_t>(sign);          // Rounds to zero
+
+        uint32_t half;
+        uint32_t rest;
+        uint32_t halfway;
+        if (f < 0x38800000) {
+            // Subnormal half, the implicit bit becomes explicit
+            const uint32_t mantissa = (f & 0x7fffff) | 0x800000;
+            const uint32_t shift = 126 - (f >> 23);
+            half = mantissa >> shift;
+            rest = mantissa & ((1u << shift) - 1);
+            halfway = 1u << (shift - 1);
+        } else {
+            // Rebias the exponent, a carry out of the mantissa rounds up into it
+            half = (f >> 13) - ((127 - 15) << 10);
+            rest = f & 0x1fff;
+            halfway = 0x1000;
+        }
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return static_cast<uint16_t>(sign | half);
+#endif
+    }
+
+    inline float half_bits_to_float(uint16_t bits) {
+#if defined(__F16C__)
+        return _cvtsh_ss(bits);
+#else
+        const uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1f;
+        uint32_t mantissa = bits & 0x3ff;
+
+        uint32_t f;
+        if (exponent == 0x1f) {
+            f = sign | 0x7f800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+        } else if (exponent != 0) {
+            f = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        } else if (mantissa == 0) {
+            f = sign;
+        } else {
+            // Subnormal half, normal float
+            exponent = 127 - 14;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            f = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+#endif
+    }
+
+    // Bulk conversions, run by the variant of layout_simd.hpp the CPU supports: 8 values per
+    // instruction with F16C, 16 with AVX-512 or AVX-512 FP16, otherwise the functions above
+    void halves_to_floats(const uint16_t *in, float *out, size_t count);
+    void floats_to_halves(const float *in, uint16_t *out, size_t count);
+
+    // A float stored in 16 bits, converting on every read and write
+    struct half {
+        uint16_t bits = 0;
+
+        half() = default;
+        half(float value) : bits(float_to_half_bits(value)) {}
+
+        operator float() const { return half_bits_to_float(bits); }
+
+        half &operator+=(float value) { return *this = *this + value; }
+        half &operator-=(float value) { return *this = *this - value; }
+        half &operator*=(float value) { return *this = *this * value; }
+        half &operator/=(float value) { return *this = *this / value; }
+    };
+} // namespace frameflow
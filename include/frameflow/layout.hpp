@@ -1,6 +1,15 @@
 #pragma once
 
+#include <frameflow/config.hpp>
+#if FRAMEFLOW_COMPACT_INPUTS
+#include <frameflow/half.hpp>
+#endif
+
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <utility>
 #include <vector>
 
 namespace frameflow {
@@ -40,6 +49,40 @@ namespace frameflow {
         float2 size;
     };
 
+#if FRAMEFLOW_COMPACT_INPUTS
+    // Storage of a float2 node input, read and written like a float2
+    struct half2 {
+        half x;
+        half y;
+
+        half2() = default;
+        half2(float x_, float y_) : x(x_), y(y_) {}
+        half2(const float2 &value) : x(value.x), y(value.y) {}
+
+        half2 &operator+=(const float2 &other) { return *this = float2(*this) + other; }
+        half2 &operator-=(const float2 &other) { return *this = float2(*this) - other; }
+
+        operator float2() const {
+#if defined(__F16C__)
+            // Both lanes in one conversion
+            uint32_t bits;
+            std::memcpy(&bits, this, sizeof(bits));
+            const __m128 value = _mm_cvtph_ps(_mm_cvtsi32_si128(static_cast<int>(bits)));
+            return {_mm_cvtss_f32(value), _mm_cvtss_f32(_mm_shuffle_ps(value, value, 1))};
+#else
+            return {x, y};
+#endif
+        }
+    };
+
+    // Node inputs (minimum size, expand, stretch, anchors, offsets) as stored in Node
+    using input_float = half;
+    using input_float2 = half2;
+#else
+    using input_float = float;
+    using input_float2 = float2;
+#endif
+
     // Generational index for safe node references
     struct NodeId {
         uint32_t index = UINT32_MAX;
@@ -60,12 +103,26 @@ namespace frameflow {
 
     constexpr NodeId NullNode = {UINT32_MAX, 0};
 
+    // Handles returned by the add_* functions of nodes with component data.
+    // They convert to NodeId, and the data accessors below take them to document what they
+    // expect. A handle can still be built from any NodeId (BoxId{id}), so the accessors check
+    // the node's own type and fail like on a deleted node when it doesn't match.
+    struct BoxId : NodeId {};
+    struct FlowId : NodeId {};
+    struct MarginId : NodeId {};
+    struct StackId : NodeId {};
+    struct MasonryId : NodeId {};
+    struct EmbedId : NodeId {};
+
     enum class NodeType : uint8_t {
         Generic,
         Center,
         Box,
         Flow,
-        Margin
+        Margin,
+        Stack,
+        Masonry,
+        Embed
         // Scroll?
         //
     };
@@ -85,6 +142,7 @@ namespace frameflow {
     struct BoxData {
         Direction direction = Direction::Horizontal;
         Align align = Align::Start;
+        bool indexed = false; // Keep a BoxIndex for the children, see find_box_child
     };
 
     struct FlowData {
@@ -99,55 +157,222 @@ namespace frameflow {
         float bottom = 0.f;
     };
 
+    // Pages stacked on top of each other, only the active one is laid out
+    struct StackData {
+        uint32_t active = 0; // Index into the node's children, see set_active_page
+    };
+
+    // Columns of equal width, each child goes to the shortest column
+    struct MasonryData {
+        uint32_t columns = 2;
+        float spacing = 0.f; // Between columns and between children of a column
+    };
+
+    struct System;
+
+    // Root of another System shown in place of the node, see add_embed
+    struct EmbedData {
+        System *system = nullptr; // Not owned
+        NodeId root = NullNode;
+    };
+
+    // Placement progress of a Masonry node. Children appended since the last solve are placed
+    // from the stored column heights, without measuring the placed ones again. A new width or
+    // data, invalidating a placed child, or removing or reordering children restarts from empty
+    // columns.
+    struct MasonryState {
+        std::vector<std::pair<float, uint32_t> > columns; // Min-heap of (height, column)
+        std::vector<float> heights;                        // Of each placed child, to move them with the node
+        uint32_t placed = 0;                               // Children placed so far
+        NodeId last = NullNode;                            // Last child placed
+        Rect bounds;                                       // Bounds of the node when placing them
+        MasonryData data;
+        bool mirrored = false;
+        bool relative = false; // A placed child has a percentage height, the node's height matters too
+    };
+
+    // Inputs and bounds of each page of a Stack after it was last solved as the active page,
+    // hash 0 if unknown. The page is skipped while they don't change.
+    struct PageHash {
+        NodeId page = NullNode;
+        uint64_t hash = 0;
+    };
+
+    struct StackState {
+        std::vector<PageHash> pages; // By child position, checked against the child's handle
+    };
+
+    // Prefix sums over the children of an indexed Box, 1-based Fenwick trees. Rebuilt by every
+    // solve of the Box and when queried after its children or its size changed,
+    // update_box_child refreshes a single child in between.
+    struct BoxIndex {
+        std::vector<float> sizes;    // Main-axis size of each child before expanding
+        std::vector<float> weights;  // Stretch of each expanding child, 0 for the others
+        std::vector<double> size_tree;
+        std::vector<double> weight_tree;
+        double total_size = 0.0;
+        double total_weight = 0.0;
+        float2 box_size;             // Size of the Box the sizes were measured in
+        bool valid = false;
+    };
+
+    // Alternative behavior for a node, active while the width assigned to the node
+    // lies in [min_width, max_width). The first matching entry of a node's table wins;
+    // when none match, the node's own type and component are used.
+    struct Breakpoint {
+        float min_width = 0.f;
+        float max_width = std::numeric_limits<float>::infinity();
+        NodeType type = NodeType::Generic;
+        uint32_t component_index = 0;
+    };
+
+    constexpr uint32_t NoBreakpoints = UINT32_MAX;
+    constexpr uint32_t NoChildIndex = UINT32_MAX;
+
     struct Components {
+#if FRAMEFLOW_ENABLE_BOX
         std::vector<BoxData> boxes;
+        std::vector<BoxIndex> box_indices; // Same index as boxes, used while BoxData::indexed is set
+        std::vector<uint32_t> free_boxes;
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
         std::vector<FlowData> flows;
+        std::vector<uint32_t> free_flows;
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
         std::vector<MarginData> margins;
-
-        std::vector<size_t> free_boxes;
-        std::vector<size_t> free_flows;
-        std::vector<size_t> free_margins;
+        std::vector<uint32_t> free_margins;
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+        std::vector<StackData> stacks;
+        std::vector<StackState> stack_states; // Same index as stacks
+        std::vector<uint32_t> free_stacks;
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+        std::vector<MasonryData> masonries;
+        std::vector<MasonryState> masonry_states; // Same index as masonries
+        std::vector<uint32_t> free_masonries;
+#endif
+#if FRAMEFLOW_ENABLE_EMBED
+        std::vector<EmbedData> embeds;
+        std::vector<uint32_t> free_embeds;
+#endif
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+        std::vector<std::vector<Breakpoint> > breakpoints;
+        std::vector<uint32_t> free_breakpoints;
+#endif
     };;
 
     // Anchors normalized [0..1] relative to parent
     struct Anchors {
-        float left = 0.f;
-        float top = 0.f;
-        float right = 0.f;
-        float bottom = 0.f;
+        input_float left = 0.f;
+        input_float top = 0.f;
+        input_float right = 0.f;
+        input_float bottom = 0.f;
     };
 
     // Pixel offsets from anchors
     struct Offsets {
-        float left = 0.f;
-        float top = 0.f;
-        float right = 0.f;
-        float bottom = 0.f;
+        input_float left = 0.f;
+        input_float top = 0.f;
+        input_float right = 0.f;
+        input_float bottom = 0.f;
     };
 
+    // Fields are ordered to pack with little padding in every configuration, see config.hpp
     struct Node {
         Rect bounds;
-        float2 minimum_size;
+        input_float2 minimum_size;
 
+#if FRAMEFLOW_ENABLE_EXPAND
         // Godot-style sizing
-        float2 expand = {0.f, 0.f};    // 1 = expand along axis
-        float2 stretch = {1.f, 1.f};   // relative weighting when expanding
+        input_float2 expand = {0.f, 0.f};   // 1 = expand along axis
+        input_float2 stretch = {1.f, 1.f};  // relative weighting when expanding
+#endif
+
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+        // Parent-relative sizing, resolved by every container in the same pass
+        float2 percent_size = {0.f, 0.f};  // fraction of the parent's content size, 0 = unused
+#endif
 
+#if FRAMEFLOW_ENABLE_ANCHORS
         // Anchors
         Anchors anchors;
         Offsets offsets;
+        NodeId anchor_target = NullNode; // Anchor to this node instead of the parent, see set_anchor_target
+#endif
 
         NodeId parent = NullNode;
         std::vector<NodeId> children;
 
-        NodeType type;
-        size_t component_index = 0;
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+        float aspect_ratio = 0.f;          // locked width / height, 0 = unused
+#endif
+
+        uint32_t component_index = 0;
+
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+        // Index into Components::breakpoints, or NoBreakpoints
+        uint32_t breakpoint_index = NoBreakpoints;
+#endif
 
         // Generation tracking
         uint32_t generation = 0;
+
+#if FRAMEFLOW_ENABLE_FLAGS
+        // Bits for the host (interactive, has text, needs redraw...), see set_node_flags
+        uint32_t flags = 0;
+        uint32_t subtree_flags = 0; // flags of the node and all its descendants, or-ed
+#endif
+
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        // Bounding box of the descendants placed by the last layout, in the same space as bounds.
+        // Empty at the node's origin without children. Scroll containers use it as content size.
+        // get_bounds only solves a path, nodes on it cover their children's bounds alone.
+        Rect content_extent;
+        bool overflow = false; // content_extent reaches outside bounds
+#endif
+
+        NodeType type;
         bool alive = true;
+
+        // Children are placed for the current bounds, see invalidate_layout
+        bool layout_clean = false;
+
+        // Lay out this subtree right-to-left, prefer set_mirror_x over writing it directly
+        bool mirror_x = false;
+
+        // Children with identical subtrees reuse one solved layout, see set_share_layouts
+        bool share_children = false;
+
+        // The node or a descendant is a Flow or a Masonry, as its own type or a breakpoint's.
+        // Other subtrees have a height that doesn't depend on their width, they aren't measured.
+        bool subtree_wraps = false;
     };;
 
+#if !FRAMEFLOW_ENABLE_ANCHORS && !FRAMEFLOW_ENABLE_EXPAND && !FRAMEFLOW_ENABLE_RELATIVE_SIZE && \
+    !FRAMEFLOW_ENABLE_BREAKPOINTS && !FRAMEFLOW_ENABLE_CONTENT_EXTENT && !FRAMEFLOW_ENABLE_FLAGS
+    // Bounds, minimum size, parent, children, component, generation and the state bits
+    static_assert(sizeof(Node) <= sizeof(std::vector<NodeId>) + 48, "Node grew in the slim configuration");
+#endif
+
+    // Height of a node with wrapping content at one width, valid during one layout pass
+    struct MeasuredHeight {
+        uint32_t pass = 0; // System::layout_pass it was measured in, 0 if none
+        float width = 0.f;
+        float height = 0.f;
+        bool wraps = false;
+    };
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+    // A node anchored to another node than its parent, see set_anchor_target
+    struct AnchorLink {
+        NodeId target;
+        NodeId dependent;
+        Rect seen; // Bounds of the target the last time get_bounds checked it
+    };
+#endif
+
     // A tree root, all ancestors of root are have relative positions to this System
     // Analogous to CanvasLayer in Godot
     // This is designed to have multiple root nodes if you wish.
@@ -157,17 +382,106 @@ namespace frameflow {
         Components components;
         std::vector<NodeId> children;
         std::vector<uint32_t> free_list; // Indices available for reuse
+
+        uint32_t layout_pass = 0; // Incremented by every layout entry point
+        uint64_t structure_version = 0; // Incremented when what a layout tape visits changes, see layout_tape.hpp
+        std::vector<MeasuredHeight> measured; // By node index, grown as wrapping subtrees are measured
+#if FRAMEFLOW_ENABLE_ANCHORS
+        std::vector<AnchorLink> anchor_links; // One per node with an anchor target, see get_bounds
+#endif
+
+        // Shared subtrees, skipped Stack pages and resumed Masonry placement.
+        // Turning them off gives the plain relayout, see compute_layout_validated.
+        bool fast_paths = true;
     };
 
+#if FRAMEFLOW_ENABLE_CENTER
     NodeId add_center(System *sys, NodeId parent);
+#endif
 
     NodeId add_generic(System *sys, NodeId parent);
 
-    NodeId add_box(System *sys, NodeId parent, const BoxData &data);
-
-    NodeId add_flow(System *sys, NodeId parent, const FlowData &data);
-
-    NodeId add_margin(System *sys, NodeId parent, const MarginData &data);
+#if FRAMEFLOW_ENABLE_BOX
+    BoxId add_box(System *sys, NodeId parent, const BoxData &data);
+
+    // Component data of the node itself, breakpoints keep their own.
+    // nullptr if the node was deleted or isn't a Box.
+    const BoxData *get_box_data(const System *sys, BoxId id);
+
+    // Replace the component data and invalidate the node, see invalidate_layout.
+    // Returns false if the node was deleted or isn't a Box.
+    bool set_box_data(System *sys, BoxId id, const BoxData &data);
+
+    // Indexed Box queries, for long lists (virtual scrolling, variable row heights...).
+    // Offsets are along the main axis from the start edge of the Box, at its current size,
+    // and take alignment, expanding and spacing into account like the solver. Each query is
+    // O(log n) on a valid index; the first one after children were added or removed, or the Box
+    // was resized, rebuilds it. They use the Box's own data, not its breakpoints.
+
+    // Child whose span contains offset, clamped to the first and last child.
+    // NoChildIndex if the node doesn't exist, isn't a Box, isn't indexed or has no children.
+    uint32_t find_box_child(System *sys, BoxId box, float offset);
+
+    // Main-axis offset and size of a child. Returns false if the node doesn't exist,
+    // isn't a Box, isn't indexed or index is out of range.
+    bool get_box_child_span(System *sys, BoxId box, uint32_t index, float *offset, float *size);
+
+    // Measure one child again after its inputs changed, O(log n), and invalidate it like
+    // invalidate_layout. Returns false if the node doesn't exist, isn't a Box, isn't indexed or
+    // index is out of range.
+    bool update_box_child(System *sys, BoxId box, uint32_t index);
+#endif
+
+#if FRAMEFLOW_ENABLE_FLOW
+    FlowId add_flow(System *sys, NodeId parent, const FlowData &data);
+
+    // See get_box_data and set_box_data
+    const FlowData *get_flow_data(const System *sys, FlowId id);
+    bool set_flow_data(System *sys, FlowId id, const FlowData &data);
+#endif
+
+#if FRAMEFLOW_ENABLE_MARGIN
+    MarginId add_margin(System *sys, NodeId parent, const MarginData &data);
+
+    // See get_box_data and set_box_data
+    const MarginData *get_margin_data(const System *sys, MarginId id);
+    bool set_margin_data(System *sys, MarginId id, const MarginData &data);
+#endif
+
+#if FRAMEFLOW_ENABLE_STACK
+    StackId add_stack(System *sys, NodeId parent, const StackData &data = {});
+
+    // Show another child of a Stack. Pages that were laid out before and whose inputs didn't
+    // change since are not solved again. Returns false if the node was deleted or isn't a Stack.
+    bool set_active_page(System *sys, StackId stack, uint32_t index);
+#endif
+
+#if FRAMEFLOW_ENABLE_MASONRY
+    MasonryId add_masonry(System *sys, NodeId parent, const MasonryData &data);
+
+    // See get_box_data and set_box_data
+    const MasonryData *get_masonry_data(const System *sys, MasonryId id);
+    bool set_masonry_data(System *sys, MasonryId id, const MasonryData &data);
+#endif
+
+#if FRAMEFLOW_ENABLE_EMBED
+    // A leaf standing for the tree under data.root in another System. The outer layout sizes and
+    // places it like a Generic child, from its own inputs, and never reads or writes the inner
+    // System; that one is laid out on its own schedule, on any thread, and changes inside it don't
+    // invalidate the outer tree. Children added to the Embed node itself are not laid out.
+    EmbedId add_embed(System *sys, NodeId parent, const EmbedData &data);
+
+    // See get_box_data and set_box_data, except that set_embed_data doesn't invalidate the node:
+    // the outer layout doesn't depend on the data
+    const EmbedData *get_embed_data(const System *sys, EmbedId id);
+    bool set_embed_data(System *sys, EmbedId id, const EmbedData &data);
+
+    // Give the inner root the size the Embed node got in the last outer layout, at origin 0 (the
+    // inner tree is positioned relative to the node). Invalidates the inner root if the size
+    // changed, and returns whether it did; compute_layout on the inner System is then up to the
+    // caller. Touches the inner System, so not while another thread lays it out.
+    bool sync_embed(System *sys, EmbedId id);
+#endif
 
     Node *get_node(System *sys, NodeId id);
     const Node *get_node(const System *sys, NodeId id);
@@ -184,5 +498,114 @@ namespace frameflow {
     // Returns false if either node doesn't exist or if it would create a cycle
     bool reparent_node(System *sys, NodeId node_id, NodeId new_parent);
 
+    // Where a node went, see transfer_subtree
+    struct NodeMapping {
+        NodeId from;
+        NodeId to;
+    };
+
+    // Move a subtree into another System (another window, another thread's System...) under
+    // new_parent, NullNode making it a root. Node records and component data are moved as they
+    // are, nothing is rebuilt. Handles into the subtree are invalid in from afterwards, the
+    // returned table gives their replacement (see remap_node). Anchor targets between the
+    // subtree and the rest of from are cleared on both sides. Returns an empty table if id doesn't exist in from, new_parent
+    // doesn't exist in to, or the move would create a cycle within one System.
+    std::vector<NodeMapping> transfer_subtree(System *from, NodeId id, System *to, NodeId new_parent);
+
+    // Handle of a node after transfer_subtree, NullNode if it wasn't moved.
+    // The table is sorted by old index, this is a binary search.
+    NodeId remap_node(const std::vector<NodeMapping> &mapping, NodeId old_id);
+
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+    // Responsive breakpoints.
+    // Each call appends an entry to the node's breakpoint table; the solver picks the
+    // active entry from the node's width during compute_layout, so no rebuild is needed
+    // when a resize crosses a breakpoint.
+    // Returns false if the node doesn't exist or the type needs component data.
+    bool add_breakpoint(System *sys, NodeId id, float min_width, float max_width, NodeType type);
+
+#if FRAMEFLOW_ENABLE_BOX
+    bool add_box_breakpoint(System *sys, NodeId id, float min_width, float max_width, const BoxData &data);
+#endif
+
+#if FRAMEFLOW_ENABLE_FLOW
+    bool add_flow_breakpoint(System *sys, NodeId id, float min_width, float max_width, const FlowData &data);
+#endif
+
+#if FRAMEFLOW_ENABLE_MARGIN
+    bool add_margin_breakpoint(System *sys, NodeId id, float min_width, float max_width, const MarginData &data);
+#endif
+
+    // Remove all breakpoints from a node, it reverts to its own type and component
+    bool clear_breakpoints(System *sys, NodeId id);
+#endif
+
+    // Type the node is laid out as at its current width
+    NodeType get_active_type(const System *sys, NodeId id);
+
+    // Lays out the whole subtree under node_id
     void compute_layout(System *sys, NodeId node_id);
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+    // Anchor a node to any node of the System (tooltips, dropdowns...) instead of its parent.
+    // Anchors and offsets are then relative to the target's bounds, which must be final when the
+    // node's parent is solved: use compute_layout_all when the target lives in another root.
+    // Pass NullNode to anchor to the parent again, deleting the target does the same.
+    // Returns false if the node doesn't exist,
+    // the target is set but doesn't exist, or is the node itself.
+    bool set_anchor_target(System *sys, NodeId id, NodeId target);
+#endif
+
+    // Lays out every root of the System, roots holding anchor targets before the roots
+    // anchored to them. Returns false if the roots depend on each other in a cycle,
+    // the roots in or behind the cycle are then left as they are.
+    bool compute_layout_all(System *sys);
+
+    // Switch a subtree between left-to-right and right-to-left.
+    // Box and Flow fill from the opposite edge, horizontal anchors, offsets and margins swap.
+    // Already computed bounds are reflected in place, so no relayout is needed when nothing
+    // else changed; descendants with mirror_x of their own keep their direction and only move.
+    // Returns false if the node doesn't exist.
+    bool set_mirror_x(System *sys, NodeId id, bool mirror);
+
+    // Shared layouts for repeated content (list rows, grid cells...).
+    // Children of this node whose subtrees have the same structure, inputs and assigned
+    // size are solved once by compute_layout; the others copy the solved rects translated
+    // to their own origin. Subtrees containing children placed by the host (Generic
+    // children without anchors) are always solved. Returns false if the node doesn't exist.
+    bool set_share_layouts(System *sys, NodeId id, bool share);
+
+#if FRAMEFLOW_ENABLE_FLAGS
+    // User flags.
+    // Every node carries 32 bits for the host and the or of those bits over its subtree,
+    // maintained by node creation, deletion, reparenting, transfers and set_node_flags.
+    // Queries skip the subtrees missing a wanted bit. Setting bits costs O(depth), clearing
+    // them also rescans the children of the ancestors whose aggregate changes.
+    // Returns false if the node doesn't exist.
+    bool set_node_flags(System *sys, NodeId id, uint32_t flags);
+
+    // Nodes of the subtree, root included, having every bit of mask, in pre-order.
+    // Returns false if root doesn't exist.
+    bool find_nodes(const System *sys, NodeId root, uint32_t mask, std::vector<NodeId> *out);
+
+    // Topmost node of the subtree under point having every bit of mask: later siblings are
+    // above earlier ones, children above their parent. Only active Stack pages are visited,
+    // and a subtree is skipped when point is outside both the bounds and the content extent
+    // of its root. NullNode if nothing matches.
+    NodeId hit_test(const System *sys, NodeId root, float2 point, uint32_t mask);
+#endif
+
+    // Lazy evaluation.
+    // Mark a node whose inputs changed (minimum size, anchors, component data, root bounds...).
+    // Its parent is marked too, and so is every ancestor above a parent with wrapping content,
+    // whose height is measured from its descendants.
+    // Adding, deleting and reparenting nodes invalidate automatically.
+    // A Masonry parent places all its children again, not only the appended ones.
+    void invalidate_layout(System *sys, NodeId id);
+
+    // Bounds of a node, solving only the dirty ancestors on its path from the root.
+    // Results are cached in the nodes until the next invalidation.
+    // Anchor targets the path reads are placed first, through the trees they depend on in turn,
+    // and nodes anchored to a target that moved are solved again. Other trees are left dirty.
+    Rect get_bounds(System *sys, NodeId id);
 } // namespace frameflow
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <frameflow/layout.hpp>
+
+#include <functional>
+
+namespace frameflow {
+    // Runs a task, typically by handing it to a job system or thread pool.
+    // An empty executor runs the task on a new detached thread.
+    using Executor = std::function<void(std::function<void()>)>;
+
+    // Move all storage of a System to the executor to be freed there.
+    // sys is left empty and can be reused immediately.
+    void destroy_system_async(System &&sys, const Executor &executor = {});
+
+    // Delete a node and all its descendants like delete_node. The NodeIds are invalid
+    // as soon as this returns, but the children storage of the deleted nodes is released
+    // by the executor. Returns false if the node doesn't exist or is already deleted.
+    bool release_subtree_async(System *sys, NodeId id, const Executor &executor = {});
+} // namespace frameflow
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <frameflow/layout.hpp>
+
+namespace frameflow {
+    // Results of compute_layout on a subtree, per node in the order compute_layout solves them
+    struct CachedLayout {
+        uint64_t key = 0; // layout_cache_key before the layout
+        std::vector<Rect> bounds;
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        std::vector<Rect> content_extents;
+        std::vector<uint8_t> overflow;
+#endif
+    };
+
+    // Solved layouts that outlive the process, for trees that are built the same way on every
+    // launch (menus at a given resolution). Meant for a handful of roots, lookups are linear.
+    struct LayoutCache {
+        std::vector<CachedLayout> entries;
+        uint32_t capacity = 64; // The oldest entry is dropped past it
+        bool modified = false;  // Entries were added since the last load or save
+    };
+
+    // Hash of what compute_layout reads under root: structure, node inputs, component data,
+    // breakpoints, the current bounds (root rect included) and anchor targets' bounds.
+    // 0 if root doesn't exist.
+    uint64_t layout_cache_key(const System *sys, NodeId root);
+
+    // compute_layout, unless the cache has an entry with the same key: then bounds, content
+    // extents and overflow are filled from it and nothing is solved. Returns true on a hit,
+    // misses add an entry. Returns false if root doesn't exist.
+    bool compute_layout_cached(System *sys, NodeId root, LayoutCache *cache);
+
+    // Write the entries to a file. Returns false if it couldn't be written.
+    bool save_layout_cache(LayoutCache *cache, const char *path);
+
+    // Replace the entries with the ones of a file. Returns false, leaving the cache empty, if the
+    // file is missing, truncated or from another version of the format.
+    bool load_layout_cache(LayoutCache *cache, const char *path);
+} // namespace frameflow
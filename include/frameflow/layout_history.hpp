@@ -0,0 +1,42 @@
+#pragma once
+
+#include <frameflow/layout.hpp>
+
+namespace frameflow {
+    // A node whose bounds changed in a frame, XOR of the bits of the old and new rect.
+    // Applying it again to the new rect gives the old one back.
+    struct RectDelta {
+        uint32_t node;
+        uint32_t bits[4];
+    };
+
+    struct RecordedFrame {
+        uint64_t number = 0;
+        uint32_t node_count = 0;
+        std::vector<RectDelta> changes; // Against the previous frame, capacity is reused
+    };
+
+    // The last frames of layout output for rewinding, in a ring of fixed size.
+    // Only the newest bounds are stored in full, older frames are rebuilt by undoing deltas.
+    struct LayoutRecorder {
+        std::vector<RecordedFrame> frames; // Ring
+        uint32_t newest = 0;               // Slot of the newest frame
+        uint32_t count = 0;                // Frames recorded, up to frames.size()
+        uint64_t next_number = 0;
+        std::vector<Rect> current;         // Bounds of every node at the newest frame
+    };
+
+    constexpr uint64_t NoFrame = UINT64_MAX;
+
+    // Keep the last capacity frames, drops what was recorded so far
+    void init_recorder(LayoutRecorder *recorder, uint32_t capacity);
+
+    // Record the bounds of all nodes, typically after compute_layout.
+    // Costs a comparison per node plus a copy per changed node. Returns the frame number,
+    // NoFrame if init_recorder wasn't called.
+    uint64_t record_frame(LayoutRecorder *recorder, const System *sys);
+
+    // Bounds of every node (indexed like System::nodes) at a recorded frame.
+    // Returns false if the frame is not in the ring anymore, or was never recorded.
+    bool reconstruct_frame(const LayoutRecorder *recorder, uint64_t frame, std::vector<Rect> *bounds);
+} // namespace frameflow
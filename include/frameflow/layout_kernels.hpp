@@ -0,0 +1,52 @@
+#pragma once
+
+#include "layout.hpp"
+#include "layout_simd.hpp"
+
+#include <functional>
+
+// Layout math of the container types as pure functions over caller-owned arrays, for hosts
+// that keep rects in their own components and don't need a System. The System solvers run
+// these same kernels on the children of each node, after resolving percentages, aspect
+// ratios and wrapping heights into item sizes.
+//
+// Kernels don't allocate after warming up, and out must hold items.count rects.
+
+namespace frameflow {
+    // Items to place, count entries per array
+    struct ItemSpans {
+        size_t count = 0;
+        const float2 *sizes = nullptr;   // Minimum size of each item
+        const float2 *expand = nullptr;  // Expand weights, nothing expands if null
+        const float2 *stretch = nullptr; // Stretch weights, all 1 if null
+    };
+
+    // Receives each item's rect in order, for hosts that finish an item as soon as it is placed
+    using PlaceItem = std::function<void(size_t index, const Rect &rect)>;
+
+    // Items side by side along the direction, expanding ones share the leftover space by stretch
+    // weight. On the cross axis they start at the frame and keep their size.
+    void box_kernel(const ItemSpans &items, const Rect &frame, const BoxData &data, bool mirrored, Rect *out);
+
+    // box_kernel handing the rects to place instead of writing an array, the System lays out
+    // Boxes with it
+    void box_kernel(const ItemSpans &items, const Rect &frame, const BoxData &data, bool mirrored,
+                    const PlaceItem &place);
+
+    // Items in lines along the direction, a line wraps when the next item would cross the frame.
+    // Expanding items fill the frame on the cross axis.
+    void flow_kernel(const ItemSpans &items, const Rect &frame, const FlowData &data, bool mirrored, Rect *out);
+
+    // Frame inset by the margins, right-to-left swaps the horizontal ones
+    Rect margin_inner_rect(const Rect &frame, const MarginData &data, bool mirrored);
+
+    // Items at the origin of the inner rect, expanding ones fill it
+    void margin_kernel(const ItemSpans &items, const Rect &frame, const MarginData &data, bool mirrored, Rect *out);
+
+    // Items centered in the frame, expanding ones fill it
+    void center_kernel(const ItemSpans &items, const Rect &frame, Rect *out);
+
+    // Rects take the edges their anchors and offsets give inside their frames, on each axis where
+    // those span a nonzero extent; other axes are left as they are
+    void anchor_kernel(const AnchorSpans &in, bool mirrored, Rect *rects);
+} // namespace frameflow
@@ -13,6 +13,9 @@ inline const char* node_type_name(NodeType type) {
         case NodeType::Box: return "Box";
         case NodeType::Flow: return "Flow";
         case NodeType::Margin: return "Margin";
+        case NodeType::Stack: return "Stack";
+        case NodeType::Masonry: return "Masonry";
+        case NodeType::Embed: return "Embed";
         default: return "Unknown";
     }
 }
@@ -53,6 +56,7 @@ inline void print_node_recursive(const System* sys, NodeId id, int indent = 0, c
     std::cout << indent_str << "  MinSize: (" << node->minimum_size.x << ", "
               << node->minimum_size.y << ")" << std::endl;
 
+#if FRAMEFLOW_ENABLE_EXPAND
     // Print expand/stretch if non-default
     if (node->expand.x > 0 || node->expand.y > 0) {
         std::cout << indent_str << "  Expand: (" << node->expand.x << ", " << node->expand.y << ")";
@@ -61,7 +65,32 @@ inline void print_node_recursive(const System* sys, NodeId id, int indent = 0, c
         }
         std::cout << std::endl;
     }
+#endif
 
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+    if (node->overflow) {
+        std::cout << indent_str << "  Overflow: content (" << node->content_extent.origin.x << ", "
+                  << node->content_extent.origin.y << ") " << node->content_extent.size.x << "x"
+                  << node->content_extent.size.y << std::endl;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_FLAGS
+    if (node->subtree_flags) {
+        std::cout << indent_str << "  Flags: 0x" << std::hex << node->flags << " subtree 0x"
+                  << node->subtree_flags << std::dec << std::endl;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+    // Print parent-relative sizing if set
+    if (node->percent_size.x > 0 || node->percent_size.y > 0 || node->aspect_ratio > 0) {
+        std::cout << indent_str << "  Percent: (" << node->percent_size.x * 100 << "%, "
+                  << node->percent_size.y * 100 << "%) Aspect: " << node->aspect_ratio << std::endl;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_ANCHORS
     // Print anchors if non-default
     if (node->anchors.left != 0 || node->anchors.top != 0 ||
         node->anchors.right != 0 || node->anchors.bottom != 0) {
@@ -70,6 +99,9 @@ inline void print_node_recursive(const System* sys, NodeId id, int indent = 0, c
                   << " R=" << node->anchors.right
                   << " B=" << node->anchors.bottom << std::endl;
     }
+    if (!node->anchor_target.is_null()) {
+        std::cout << indent_str << "  Anchor target: " << node->anchor_target.index << std::endl;
+    }
 
     // Print offsets if non-default
     if (node->offsets.left != 0 || node->offsets.top != 0 ||
@@ -79,21 +111,27 @@ inline void print_node_recursive(const System* sys, NodeId id, int indent = 0, c
                   << " R=" << node->offsets.right
                   << " B=" << node->offsets.bottom << std::endl;
     }
+#endif
 
     // Print component-specific data
     switch (node->type) {
+#if FRAMEFLOW_ENABLE_BOX
         case NodeType::Box: {
             const BoxData& box = sys->components.boxes[node->component_index];
             std::cout << indent_str << "  Box: " << direction_name(box.direction)
-                      << ", " << align_name(box.align) << std::endl;
+                      << ", " << align_name(box.align) << (box.indexed ? ", indexed" : "") << std::endl;
             break;
         }
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
         case NodeType::Flow: {
             const FlowData& flow = sys->components.flows[node->component_index];
             std::cout << indent_str << "  Flow: " << direction_name(flow.direction)
                       << ", " << align_name(flow.align) << std::endl;
             break;
         }
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
         case NodeType::Margin: {
             const MarginData& margin = sys->components.margins[node->component_index];
             std::cout << indent_str << "  Margin: L=" << margin.left
@@ -102,10 +140,41 @@ inline void print_node_recursive(const System* sys, NodeId id, int indent = 0, c
                       << " B=" << margin.bottom << std::endl;
             break;
         }
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+        case NodeType::Stack: {
+            const StackData& stack = sys->components.stacks[node->component_index];
+            std::cout << indent_str << "  Stack: active=" << stack.active << std::endl;
+            break;
+        }
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+        case NodeType::Masonry: {
+            const MasonryData& masonry = sys->components.masonries[node->component_index];
+            std::cout << indent_str << "  Masonry: columns=" << masonry.columns
+                      << " spacing=" << masonry.spacing << std::endl;
+            break;
+        }
+#endif
+#if FRAMEFLOW_ENABLE_EMBED
+        case NodeType::Embed: {
+            const EmbedData& embed = sys->components.embeds[node->component_index];
+            std::cout << indent_str << "  Embed: root ID(" << embed.root.index << ":" << embed.root.generation
+                      << ")" << (embed.system ? "" : ", no system") << std::endl;
+            break;
+        }
+#endif
         default:
             break;
     }
 
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+    if (node->breakpoint_index != NoBreakpoints) {
+        std::cout << indent_str << "  Breakpoints: " << sys->components.breakpoints[node->breakpoint_index].size()
+                  << " (active: " << node_type_name(get_active_type(sys, id)) << ")" << std::endl;
+    }
+#endif
+
     // Print children count
     if (!node->children.empty()) {
         std::cout << indent_str << "  Children: " << node->children.size() << std::endl;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <frameflow/layout.hpp>
+
+#include <functional>
+
+namespace frameflow {
+    // A subtree whose bounds differ between the active solver path and the reference path.
+    // Descendants of node aren't reported separately. A node whose bounds match is reported
+    // when its content extent or overflow differ and none of its descendants' bounds do.
+    struct ShadowMismatch {
+        NodeId node;
+        Rect active;    // What compute_layout produced, left in place
+        Rect reference; // What the reference path produced
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        Rect active_extent;
+        Rect reference_extent;
+#endif
+    };
+
+    using ShadowCallback = std::function<void(const ShadowMismatch &)>;
+
+    // Shadow validation of the fast paths (shared subtrees, skipped Stack pages, resumed
+    // Masonry placement) against a plain relayout, on a sampled fraction of frames.
+    struct ShadowValidator {
+        float sample_rate = 0.f;  // Fraction of frames validated, 0 = never, 1 = always
+        float tolerance = 1e-3f;  // Largest difference of a coordinate that still matches
+        ShadowCallback on_mismatch;
+
+        uint64_t rng = 0x2545F4914F6CDD1Dull; // Sampling state, any non zero value
+
+        // Statistics
+        uint64_t frames = 0;
+        uint64_t sampled = 0;
+        uint64_t mismatches = 0;
+
+        // Copy of the nodes the reference path reads, in the slots they have in the live System.
+        // Kept to avoid allocating on sampled frames.
+        System reference;
+    };
+
+    // compute_layout, then on sampled frames solve a copy of the subtree from the same starting
+    // bounds and content extents with System::fast_paths off and report differences. The live
+    // nodes only ever hold the active results. Unsampled frames cost one random number.
+    // Returns whether the frame was sampled.
+    bool compute_layout_validated(System *sys, NodeId root, ShadowValidator *validator);
+} // namespace frameflow
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace frameflow {
+    struct Rect;
+
+    // Instruction sets the kernels below are built for. x86 builds carry every variant and
+    // pick the best one the CPU supports once per process; other builds only have Scalar.
+    enum class Isa : uint8_t {
+        Scalar,
+        Sse4,
+        Avx2,       // With F16C for the half conversions
+        Avx512,
+        Avx512Fp16  // AVX-512 with the half conversions of AVX-512 FP16
+    };
+
+    // Best variant for this CPU and build, detected on first use
+    Isa detected_isa();
+
+    // Variant the kernels currently run, detected_isa() unless forced
+    Isa active_isa();
+
+    // Run another variant, for tests and benchmarks. Every variant gives bit-identical results.
+    // Returns false if the CPU or the build doesn't support it.
+    bool force_isa(Isa isa);
+
+    const char *isa_name(Isa isa);
+
+    // Anchors, offsets and frames of count items, one array per field (see Node::anchors)
+    struct AnchorSpans {
+        size_t count = 0;
+        const float *anchor_left = nullptr;
+        const float *anchor_top = nullptr;
+        const float *anchor_right = nullptr;
+        const float *anchor_bottom = nullptr;
+        const float *offset_left = nullptr;
+        const float *offset_top = nullptr;
+        const float *offset_right = nullptr;
+        const float *offset_bottom = nullptr;
+        const float *frame_x = nullptr;
+        const float *frame_y = nullptr;
+        const float *frame_width = nullptr;
+        const float *frame_height = nullptr;
+    };
+
+    // Edges computed for each item
+    struct EdgeSpans {
+        float *left = nullptr;
+        float *top = nullptr;
+        float *right = nullptr;
+        float *bottom = nullptr;
+    };
+
+    // Edges the anchors and offsets give inside each frame, horizontal ones swapped if mirrored.
+    // An axis whose far edge isn't past its near edge isn't anchored.
+    void resolve_anchor_spans(const AnchorSpans &in, bool mirrored, const EdgeSpans &out);
+
+    // Box distribution along the main axis. Items with a nonzero weight get
+    // leftover * weight / total_weight added to their size when total_weight is positive;
+    // each item starts where the previous one ended plus spacing, the first at start.
+    void distribute_spans(const float *sizes, const float *weights, size_t count, float leftover,
+                          float total_weight, float start, float spacing, float *offsets, float *out_sizes);
+
+    // Bounds transforms over arrays of rects
+    void translate_rects(Rect *rects, size_t count, float dx, float dy);
+
+    // Reflect horizontally inside [frame_left, frame_left + frame_width], see set_mirror_x
+    void mirror_rects(Rect *rects, size_t count, float frame_left, float frame_width);
+} // namespace frameflow
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <frameflow/layout.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace frameflow {
+    // Lock-free single-producer / single-consumer queue of finished subtrees.
+    // The layout thread pushes, the render thread pops. Capacity is fixed at
+    // init so publishing never allocates during layout.
+    struct LayoutStream {
+        std::vector<NodeId> slots;
+        uint32_t mask = 0;
+
+        alignas(64) std::atomic<uint32_t> head{0}; // Next slot to pop, owned by the consumer
+        alignas(64) std::atomic<uint32_t> tail{0}; // Next slot to push, owned by the producer
+        std::atomic<bool> closed{false};
+    };
+
+    // Capacity is rounded up to a power of two
+    void init_stream(LayoutStream *stream, size_t capacity);
+
+    // Non-blocking pop, returns false if nothing is ready yet
+    bool stream_pop(LayoutStream *stream, NodeId *out);
+
+    // Blocking pop, returns false once the layout finished and everything was consumed
+    bool stream_wait_pop(LayoutStream *stream, NodeId *out);
+
+    // Lays out the subtree under root like compute_layout, publishing each subtree
+    // rooted publish_depth levels below root as soon as all of its bounds are final.
+    // Shallower leaves are published as well, so every node is covered exactly once;
+    // containers above publish_depth are final before their first descendant is published.
+    // Subtrees arrive in pre-order and the stream is closed when layout is done.
+    // The consumer must drain the previous frame before the next call.
+    void compute_layout_streaming(System *sys, NodeId root, LayoutStream *stream, uint32_t publish_depth = 1);
+} // namespace frameflow
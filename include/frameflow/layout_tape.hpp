@@ -0,0 +1,50 @@
+#pragma once
+
+#include <frameflow/layout.hpp>
+
+namespace frameflow {
+    // How a tape op picks its solver
+    enum class TapeMode : uint8_t {
+        Fixed,     // The node's own type and component, resolved when compiling
+        Variant,   // Breakpoints pick the type from the width while running
+        Recursive, // Stack pages or shared children, the subtree is left to the recursive pass
+    };
+
+    // One solve in a compiled layout, in pre-order. Only nodes with children get one, the
+    // Generic leaves a solver places are finished right after it from LayoutTape::leaves.
+    struct TapeOp {
+        uint32_t node;            // Index into System::nodes
+        uint32_t parent_op;       // Op of the parent, UINT32_MAX for the root
+        uint32_t end;             // One past the last op of the subtree
+        uint32_t first_leaf;      // Range of LayoutTape::leaves finished by this op
+        uint32_t leaf_count;
+        uint32_t component_index; // Solver data when Fixed
+        NodeType type;
+        TapeMode mode;
+    };
+
+    // A subtree flattened for layouts that change structure rarely but run every frame.
+    // Belongs to the System it was compiled from.
+    struct LayoutTape {
+        NodeId root = NullNode;
+        uint64_t structure_version = 0; // System::structure_version when compiled
+        std::vector<TapeOp> ops;
+        std::vector<uint32_t> leaves;   // Node indices, consecutive for each op
+
+        // Filled while running
+        std::vector<uint8_t> mirrored;  // Per op
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        std::vector<Rect> extents;      // Per op, the extent its children grow
+        std::vector<uint8_t> grown;     // Per op, whether a child grew it
+        std::vector<uint32_t> open;     // Ops whose subtree is being solved
+#endif
+    };
+
+    // Flatten the subtree under root. Returns false if root doesn't exist.
+    bool compile_layout(System *sys, NodeId root, LayoutTape *tape);
+
+    // Same result as compute_layout on the tape's root, in a loop over the ops instead of a
+    // recursion. Recompiles first if nodes were added, deleted or moved, breakpoints changed or
+    // shared layouts were toggled since compile_layout.
+    void run_layout_tape(System *sys, LayoutTape *tape);
+} // namespace frameflow
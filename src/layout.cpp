@@ -1,225 +1,1039 @@
 #include "frameflow/layout.hpp"
+#include "frameflow/layout_kernels.hpp"
+#include "layout_internal.hpp"
+#include "simd/kernels_impl.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <functional>
 
 namespace frameflow {
-    static void resolve_anchors(Node &child, const Node &parent) {
-        // Compute rectangle from anchors + offsets
-        float parent_left = parent.bounds.origin.x;
-        float parent_top = parent.bounds.origin.y;
-        /*
-        float parent_right = parent_left + parent.bounds.size.x;
-        float parent_bottom = parent_top + parent.bounds.size.y;
-        */
-
-        float x0 = parent_left + child.anchors.left * parent.bounds.size.x + child.offsets.left;
-        float y0 = parent_top + child.anchors.top * parent.bounds.size.y + child.offsets.top;
-        float x1 = parent_left + child.anchors.right * parent.bounds.size.x - child.offsets.right;
-        float y1 = parent_top + child.anchors.bottom * parent.bounds.size.y - child.offsets.bottom;
-
-        // Only override bounds if anchors define a nonzero area
-        if (x1 > x0) child.bounds.origin.x = x0, child.bounds.size.x = x1 - x0;
-        if (y1 > y0) child.bounds.origin.y = y0, child.bounds.size.y = y1 - y0;
-    }
-
-    static void layout_generic(System *sys, const Node &node) {
-        for (NodeId child_id: node.children) {
-            Node &child = *get_node(sys, child_id);
+    // Optional node inputs, nodes built without them behave as if they had the defaults
+    [[maybe_unused]] static float2 expand_of(const Node &node) {
+#if FRAMEFLOW_ENABLE_EXPAND
+        return node.expand;
+#else
+        (void) node;
+        return {0.f, 0.f};
+#endif
+    }
 
-            // Compute anchors
-            resolve_anchors(child, node);
+    [[maybe_unused]] static float2 stretch_of(const Node &node) {
+#if FRAMEFLOW_ENABLE_EXPAND
+        return node.stretch;
+#else
+        (void) node;
+        return {1.f, 1.f};
+#endif
+    }
 
-            // Apply minimum size
-            child.bounds.size.x = std::max(child.bounds.size.x, child.minimum_size.x);
-            child.bounds.size.y = std::max(child.bounds.size.y, child.minimum_size.y);
+    // Breakpoint table of a node, nullptr if it has none
+    static const std::vector<Breakpoint> *breakpoints_of(const System *sys, const Node &node) {
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+        if (node.breakpoint_index == NoBreakpoints) return nullptr;
+        return &sys->components.breakpoints[node.breakpoint_index];
+#else
+        (void) sys;
+        (void) node;
+        return nullptr;
+#endif
+    }
 
-            // Apply expand (fill parent along axis)
-            if (child.expand.x > 0.f)
-                child.bounds.size.x = std::max(child.bounds.size.x, node.bounds.size.x);
-            if (child.expand.y > 0.f)
-                child.bounds.size.y = std::max(child.bounds.size.y, node.bounds.size.y);
+    static uint32_t subtree_flags_of(const Node &node) {
+#if FRAMEFLOW_ENABLE_FLAGS
+        return node.subtree_flags;
+#else
+        (void) node;
+        return 0;
+#endif
+    }
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+    struct Edges {
+        float left;
+        float top;
+        float right;
+        float bottom;
+    };
+
+    // Anchors or offsets as floats. Four compact inputs are converted inline, too few to pay
+    // for the dispatch of halves_to_floats.
+    template<typename T>
+    static Edges load_edges(const T &edges) {
+#if FRAMEFLOW_COMPACT_INPUTS
+        static_assert(sizeof(T) == 4 * sizeof(uint16_t), "left, top, right and bottom halves");
+        uint16_t bits[4];
+        std::memcpy(bits, &edges, sizeof(bits));
+        return {half_bits_to_float(bits[0]), half_bits_to_float(bits[1]), half_bits_to_float(bits[2]),
+                half_bits_to_float(bits[3])};
+#else
+        return {edges.left, edges.top, edges.right, edges.bottom};
+#endif
+    }
+
+    // Node the anchors of child are relative to, if it isn't its parent
+    static const Node *anchor_target(const System *sys, const Node &child) {
+        if (child.anchor_target.is_null()) return nullptr;
+        return get_node(sys, child.anchor_target);
+    }
+#endif
+
+    // Horizontal extent the anchors and offsets give a child inside parent_width,
+    // the child is anchored horizontally if it is positive
+    static float anchored_width(const System *sys, const Node &child, float parent_width) {
+#if FRAMEFLOW_ENABLE_ANCHORS
+        if (const Node *target = anchor_target(sys, child)) parent_width = target->bounds.size.x;
+        const Edges anchors = load_edges(child.anchors);
+        const Edges offsets = load_edges(child.offsets);
+        return (anchors.right - anchors.left) * parent_width - offsets.left - offsets.right;
+#else
+        (void) sys;
+        (void) child;
+        (void) parent_width;
+        return 0.f;
+#endif
+    }
+
+    // Whether the anchors of a node are relative to another node than its parent
+    static bool has_anchor_target(const Node &node) {
+#if FRAMEFLOW_ENABLE_ANCHORS
+        return !node.anchor_target.is_null();
+#else
+        (void) node;
+        return false;
+#endif
+    }
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+    // Remove the links of a node going away, as a dependent and as a target. Nodes anchored
+    // to it fall back to their parent.
+    static void unlink_anchors(System *sys, NodeId id) {
+        std::vector<AnchorLink> &links = sys->anchor_links;
+        for (size_t i = 0; i < links.size();) {
+            if (links[i].dependent != id && links[i].target != id) {
+                i++;
+                continue;
+            }
+            const NodeId dependent = links[i].dependent;
+            links[i] = links.back();
+            links.pop_back();
+
+            sys->nodes[dependent.index].anchor_target = NullNode;
+            if (dependent != id) invalidate_layout(sys, dependent);
         }
     }
 
+    // Anchor kernel inputs of a child inside frame (or its anchor target), one per AnchorSpans
+    // field, stride floats apart. Returns false if it has no anchors or offsets, which can't
+    // span an extent.
+    static bool gather_anchors(const System *sys, const Node &child, const Rect &frame, float *out, size_t stride) {
+        const Edges anchors = load_edges(child.anchors);
+        const Edges offsets = load_edges(child.offsets);
+        if (anchors.left == 0.f && anchors.top == 0.f && anchors.right == 0.f && anchors.bottom == 0.f &&
+            offsets.left == 0.f && offsets.top == 0.f && offsets.right == 0.f && offsets.bottom == 0.f)
+            return false;
 
-    static void layout_center(System *sys, const Node &node) {
-        if (node.children.empty()) return;
+        const Node *target = anchor_target(sys, child);
+        const Rect &f = target ? target->bounds : frame;
+        const float values[12] = {
+            anchors.left, anchors.top, anchors.right, anchors.bottom,
+            offsets.left, offsets.top, offsets.right, offsets.bottom,
+            f.origin.x, f.origin.y, f.size.x, f.size.y
+        };
+        for (size_t field = 0; field < 12; field++) out[field * stride] = values[field];
+        return true;
+    }
 
-        for (NodeId child_id: node.children) {
-            Node &child = *get_node(sys, child_id);
+    static AnchorSpans anchor_spans(const float *fields, size_t stride, size_t count) {
+        AnchorSpans spans;
+        spans.count = count;
+        spans.anchor_left = fields;
+        spans.anchor_top = fields + stride;
+        spans.anchor_right = fields + stride * 2;
+        spans.anchor_bottom = fields + stride * 3;
+        spans.offset_left = fields + stride * 4;
+        spans.offset_top = fields + stride * 5;
+        spans.offset_right = fields + stride * 6;
+        spans.offset_bottom = fields + stride * 7;
+        spans.frame_x = fields + stride * 8;
+        spans.frame_y = fields + stride * 9;
+        spans.frame_width = fields + stride * 10;
+        spans.frame_height = fields + stride * 11;
+        return spans;
+    }
+#endif
+
+    // Anchors of a run of children inside frame, or inside their anchor target, resolved by the
+    // anchor kernel. anchored_x, if not null, receives whether each child was placed horizontally.
+    static void resolve_anchors(System *sys, detail::ChildRange children, const Rect &frame, bool mirrored,
+                                uint8_t *anchored_x) {
+        const auto count = static_cast<size_t>(children.end() - children.begin());
+        if (anchored_x) std::fill(anchored_x, anchored_x + count, 0);
+#if !FRAMEFLOW_ENABLE_ANCHORS
+        (void) sys;
+        (void) frame;
+        (void) mirrored;
+#else
+        // Runs narrower than a vector go through the scalar lane of the kernel a child at a time,
+        // like the tail of every variant, without gathering them
+        if (count < 4) {
+            for (size_t i = 0; i < count; i++) {
+                Node &child = sys->nodes[children.begin()[i].index];
+                float fields[12];
+                if (!gather_anchors(sys, child, frame, fields, 1)) continue;
+
+                float edges[4];
+                detail::anchor_step<detail::ScalarLane>(anchor_spans(fields, 1, 1), mirrored,
+                                                        {&edges[0], &edges[1], &edges[2], &edges[3]}, 0);
+                const bool placed = detail::apply_anchor_edges(child.bounds, edges[0], edges[1], edges[2], edges[3]);
+                if (anchored_x) anchored_x[i] = placed;
+            }
+            return;
+        }
 
-            resolve_anchors(child, node);
+        // Wider runs are gathered a block at a time on the stack
+        constexpr size_t Block = 64;
+        float fields[12 * Block];
+        Rect rects[Block];
+        uint32_t positions[Block];
+        uint8_t placed[Block];
+
+        size_t i = 0;
+        while (i < count) {
+            size_t gathered = 0;
+            for (; i < count && gathered < Block; i++) {
+                const Node &child = sys->nodes[children.begin()[i].index];
+                if (!gather_anchors(sys, child, frame, fields + gathered, Block)) continue;
+                rects[gathered] = child.bounds;
+                positions[gathered] = static_cast<uint32_t>(i);
+                gathered++;
+            }
+            if (gathered == 0) continue;
 
-            // Start with minimum size
-            float2 size = child.minimum_size;
-            // how to get size to be ratio of parent?
+            detail::anchor_rects(anchor_spans(fields, Block, gathered), mirrored, rects, placed);
+            for (size_t k = 0; k < gathered; k++) {
+                sys->nodes[children.begin()[positions[k]].index].bounds = rects[k];
+                if (anchored_x) anchored_x[positions[k]] = placed[k];
+            }
+        }
+#endif
+    }
 
-            // Apply expand
-            if (child.expand.x > 0.f) size.x = node.bounds.size.x;
-            if (child.expand.y > 0.f) size.y = node.bounds.size.y;
+    // Reflect a horizontal span inside a frame
+    static float mirror_x(const Rect &frame, float x, float width) {
+        return frame.origin.x + frame.size.x - (x - frame.origin.x) - width;
+    }
 
-            // Center inside parent
-            float2 offset{
-                (node.bounds.size.x - size.x) * 0.5f,
-                (node.bounds.size.y - size.y) * 0.5f
-            };
-            child.bounds.origin = node.bounds.origin + offset;
-            child.bounds.size = size;
+    // Minimum size after resolving parent-relative sizing and the aspect ratio lock.
+    // The axis without a percentage follows the other one; if that would break the
+    // minimum size, the driving axis grows instead so the ratio still holds.
+    static float2 resolve_minimum_size(const Node &child, const float2 &parent_size) {
+        float2 size = child.minimum_size;
+#if !FRAMEFLOW_ENABLE_RELATIVE_SIZE
+        (void) parent_size;
+#else
+        if (child.percent_size.x > 0.f) size.x = std::max(size.x, child.percent_size.x * parent_size.x);
+        if (child.percent_size.y > 0.f) size.y = std::max(size.y, child.percent_size.y * parent_size.y);
+
+        if (child.aspect_ratio > 0.f) {
+            const bool height_driven = child.percent_size.y > 0.f && !(child.percent_size.x > 0.f);
+            if (height_driven) {
+                size.x = size.y * child.aspect_ratio;
+                if (size.x < child.minimum_size.x) {
+                    size.x = child.minimum_size.x;
+                    size.y = size.x / child.aspect_ratio;
+                }
+            } else {
+                size.y = size.x / child.aspect_ratio;
+                if (size.y < child.minimum_size.y) {
+                    size.y = child.minimum_size.y;
+                    size.x = size.y * child.aspect_ratio;
+                }
+            }
         }
+#endif
+        return size;
     }
 
+    static Breakpoint variant_at(const System *sys, const Node &node, float width);
 
-    static void layout_box(System *sys, const Node &node, const BoxData &data) {
-        if (node.children.empty()) return;
+    // ========== Height for width ==========
+    // Containers ask their children how tall they are at the width they will get.
+    // Only subtrees with wrapping content (horizontal Flow) report a height, everything
+    // else keeps its minimum size, so layouts without wrapping are unchanged.
+    // Results are cached per node for one width and one layout pass.
+
+    struct Measure {
+        float height = 0.f;
+        bool wraps = false;
+    };
+
+    static Measure measure_height(System *sys, Node &node, float width);
+
+    // Height of a child laid out at width, never less than min_height.
+    // Solvers only ask when their own node has wrapping content below it.
+    static float height_for_width(System *sys, Node &child, float width, float min_height) {
+        if (!child.subtree_wraps || child.children.empty()) return min_height;
+
+        const Measure m = measure_height(sys, child, width);
+        return m.wraps ? std::max(min_height, m.height) : min_height;
+    }
+
+    // Width a Generic, Margin or vertical Box child gets inside parent_width
+    static float child_width(const System *sys, const Node &child, float parent_width, float min_width,
+                             bool apply_expand) {
+        const float span = anchored_width(sys, child, parent_width);
+        float width = std::max(span > 0.f ? span : child.bounds.size.x, min_width);
+        if (apply_expand && expand_of(child).x > 0.f) width = std::max(width, parent_width);
+        return width;
+    }
+
+#if FRAMEFLOW_ENABLE_FLOW
+    static Measure measure_flow(System *sys, const Node &node, float width) {
+        Measure m{0.f, true};
+        float line_width = 0.f;
+        float line_height = 0.f;
+
+        for (NodeId child_id: node.children) {
+            Node &child = sys->nodes[child_id.index];
+            const float2 size = resolve_minimum_size(child, {width, node.bounds.size.y});
+            const float height = height_for_width(sys, child, size.x, size.y);
+
+            if (line_width + size.x > width) {
+                m.height += line_height;
+                line_width = 0.f;
+                line_height = 0.f;
+            }
+            line_width += size.x;
+            line_height = std::max(line_height, height);
+        }
+        m.height += line_height;
+        return m;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_BOX
+    static Measure measure_box(System *sys, const Node &node, const BoxData &data, float width) {
+        Measure m;
+        const float2 parent_size{width, node.bounds.size.y};
+
+        if (data.direction == Direction::Vertical) {
+            for (NodeId child_id: node.children) {
+                Node &child = sys->nodes[child_id.index];
+                const float2 size = resolve_minimum_size(child, parent_size);
+                const float w = child_width(sys, child, width, size.x, false);
+                m.height += height_for_width(sys, child, w, size.y);
+                m.wraps = m.wraps || measure_height(sys, child, w).wraps;
+            }
+            return m;
+        }
 
-        // Precompute total fixed size & total stretch
+        // Horizontal: children get their minimum width plus their share of the leftover
         float total_main = 0.f;
         float total_stretch = 0.f;
         for (NodeId child_id: node.children) {
-            Node &c = *get_node(sys, child_id);
-            total_main += (data.direction == Direction::Horizontal ? c.minimum_size.x : c.minimum_size.y);
-            if ((data.direction == Direction::Horizontal ? c.expand.x : c.expand.y) > 0.f)
-                total_stretch += (data.direction == Direction::Horizontal ? c.stretch.x : c.stretch.y);
+            const Node &child = sys->nodes[child_id.index];
+            total_main += resolve_minimum_size(child, parent_size).x;
+            if (expand_of(child).x > 0.f) total_stretch += stretch_of(child).x;
         }
+        const float leftover = std::max(0.f, width - total_main);
 
-        float parent_main_size = (data.direction == Direction::Horizontal ? node.bounds.size.x : node.bounds.size.y);
-        float leftover = std::max(0.f, parent_main_size - total_main);
+        for (NodeId child_id: node.children) {
+            Node &child = sys->nodes[child_id.index];
+            const float2 size = resolve_minimum_size(child, parent_size);
+            float w = size.x;
+            if (expand_of(child).x > 0.f && total_stretch > 0.f) w += leftover * (stretch_of(child).x / total_stretch);
 
-        // Determine starting cursor based on alignment
-        float cursor = (data.direction == Direction::Horizontal ? node.bounds.origin.x : node.bounds.origin.y);
-        float spacing = 0.f;
+            m.height = std::max(m.height, height_for_width(sys, child, w, size.y));
+            m.wraps = m.wraps || measure_height(sys, child, w).wraps;
+        }
+        return m;
+    }
+#endif
 
-        //float content_size = total_main + leftover; // for SpaceBetween, spacing will overwrite
-        size_t child_count = node.children.size();
+#if FRAMEFLOW_ENABLE_MASONRY
+    using Column = std::pair<float, uint32_t>; // Height, index. Ties go to the leftmost column
 
-        switch (data.align) {
-            case Align::Start: break;
-            case Align::Center: cursor += leftover * 0.5f;
-                break;
-            case Align::End: cursor += leftover;
-                break;
-            case Align::SpaceBetween:
-                if (child_count > 1) spacing = leftover / (child_count - 1);
-                break;
+    static float masonry_column_width(const MasonryData &data, float width) {
+        const uint32_t k = std::max(data.columns, 1u);
+        return std::max(0.f, (width - data.spacing * static_cast<float>(k - 1)) / static_cast<float>(k));
+    }
+
+    // Empty columns, already a valid min-heap
+    static void reset_columns(std::vector<Column> &columns, uint32_t count) {
+        columns.clear();
+        for (uint32_t c = 0; c < std::max(count, 1u); ++c) columns.emplace_back(0.f, c);
+    }
+
+    // Bottom of the tallest column, without the spacing after its last child
+    static float masonry_extent(const Column *first, const Column *last, float spacing) {
+        float extent = 0.f;
+        for (const Column *column = first; column != last; ++column)
+            if (column->first > 0.f) extent = std::max(extent, column->first - spacing);
+        return extent;
+    }
+
+    // Whether the stored heights are the ones measuring the children at width would give: same
+    // width and data, and the placed children are still the first ones. A placed child whose
+    // height changes is invalidated, which resets its Masonry parent, see invalidate_ancestors.
+    static bool masonry_resumable(const Node &node, const MasonryData &data, const MasonryState &state, float width) {
+        return state.placed > 0 && state.placed <= node.children.size() && state.heights.size() == state.placed &&
+               node.children[state.placed - 1] == state.last && state.bounds.size.x == width &&
+               (!state.relative || state.bounds.size.y == node.bounds.size.y) &&
+               state.data.columns == data.columns && state.data.spacing == data.spacing;
+    }
+
+    // Columns of the Masonry nodes being measured, nested measures push theirs after the
+    // ones of their ancestors
+    static thread_local std::vector<Column> measure_columns;
+
+    // Measures only the children appended since the last solve when it can resume from it
+    static Measure measure_masonry(System *sys, const Node &node, uint32_t comp_idx, float width) {
+        const MasonryData &data = sys->components.masonries[comp_idx];
+        const MasonryState &state = sys->components.masonry_states[comp_idx];
+        const float column_width = masonry_column_width(data, width);
+
+        std::vector<Column> &stack = measure_columns;
+        const size_t first = stack.size();
+        size_t placed = 0;
+        if (sys->fast_paths && masonry_resumable(node, data, state, width)) {
+            stack.insert(stack.end(), state.columns.begin(), state.columns.end());
+            placed = state.placed;
+        } else {
+            const uint32_t count = std::max(data.columns, 1u);
+            for (uint32_t c = 0; c < count; ++c) stack.emplace_back(0.f, c);
+        }
+
+        for (size_t i = placed; i < node.children.size(); ++i) {
+            Node &child = sys->nodes[node.children[i].index];
+            const float2 size = resolve_minimum_size(child, {column_width, node.bounds.size.y});
+
+            // Measured before touching the heap, it may grow the stack
+            const float height = height_for_width(sys, child, column_width, size.y);
+            const auto columns = stack.begin() + static_cast<std::ptrdiff_t>(first);
+            std::pop_heap(columns, stack.end(), std::greater<>());
+            stack.back().first += height + data.spacing;
+            std::push_heap(columns, stack.end(), std::greater<>());
+        }
+
+        const float extent = masonry_extent(stack.data() + first, stack.data() + stack.size(), data.spacing);
+        stack.resize(first);
+        return {extent, true};
+    }
+#endif
+
+    // Generic, Center, Margin and Stack stack their children on top of each other
+    static Measure measure_overlay(System *sys, const Node &node, float width, bool center) {
+        Measure m;
+        for (NodeId child_id: detail::active_children(sys, node)) {
+            Node &child = sys->nodes[child_id.index];
+            const float2 size = resolve_minimum_size(child, {width, node.bounds.size.y});
+            const float w = center
+                                ? (expand_of(child).x > 0.f ? width : size.x)
+                                : child_width(sys, child, width, size.x, true);
+
+            m.height = std::max(m.height, height_for_width(sys, child, w, size.y));
+            m.wraps = m.wraps || measure_height(sys, child, w).wraps;
+        }
+        return m;
+    }
+
+    static Measure measure_height(System *sys, Node &node, float width) {
+        if (!node.subtree_wraps) return {};
+        const auto index = static_cast<size_t>(&node - sys->nodes.data());
+        if (index >= sys->measured.size()) sys->measured.resize(sys->nodes.size());
+        const MeasuredHeight &cached = sys->measured[index];
+        if (cached.pass == sys->layout_pass && cached.width == width) return {cached.height, cached.wraps};
+
+        Measure m;
+        if (!node.children.empty()) {
+            // The variant the node will have at this width, not the one it has now
+            const Breakpoint variant = variant_at(sys, node, width);
+            switch (variant.type) {
+                case NodeType::Generic: m = measure_overlay(sys, node, width, false);
+                    break;
+#if FRAMEFLOW_ENABLE_CENTER
+                case NodeType::Center: m = measure_overlay(sys, node, width, true);
+                    break;
+#endif
+#if FRAMEFLOW_ENABLE_BOX
+                case NodeType::Box:
+                    m = measure_box(sys, node, sys->components.boxes[variant.component_index], width);
+                    break;
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
+                case NodeType::Flow:
+                    if (sys->components.flows[variant.component_index].direction == Direction::Horizontal)
+                        m = measure_flow(sys, node, width);
+                    break;
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
+                case NodeType::Margin: {
+                    const MarginData &margin = sys->components.margins[variant.component_index];
+                    m = measure_overlay(sys, node, std::max(0.f, width - margin.left - margin.right), false);
+                    m.height += margin.top + margin.bottom;
+                    break;
+                }
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+                case NodeType::Stack: m = measure_overlay(sys, node, width, false);
+                    break;
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+                case NodeType::Masonry:
+                    m = measure_masonry(sys, node, variant.component_index, width);
+                    break;
+#endif
+                default: break;
+            }
         }
+        m.height = std::max<float>(m.height, node.minimum_size.y);
+
+        sys->measured[index] = {sys->layout_pass, width, m.height, m.wraps};
+        return m;
+    }
+
+    // ========== Solvers ==========
+
+    static detail::ChildRange all_children(const Node &node) {
+        return {node.children.data(), node.children.data() + node.children.size()};
+    }
+
+    static void layout_generic(System *sys, const Node &node, bool mirrored) {
+        // Compute anchors, children without them keep the origin the host gave them
+        resolve_anchors(sys, all_children(node), node.bounds, mirrored, nullptr);
 
-        // Layout children
         for (NodeId child_id: node.children) {
-            Node &c = *get_node(sys, child_id);
+            Node &child = sys->nodes[child_id.index];
 
-            resolve_anchors(c, node);
+            // Apply minimum size
+            const float2 min_size = resolve_minimum_size(child, node.bounds.size);
+            child.bounds.size.x = std::max(child.bounds.size.x, min_size.x);
+            child.bounds.size.y = std::max(child.bounds.size.y, min_size.y);
 
-            float2 size = c.minimum_size;
-            float expand_axis = (data.direction == Direction::Horizontal ? c.expand.x : c.expand.y);
-            float stretch_axis = (data.direction == Direction::Horizontal ? c.stretch.x : c.stretch.y);
+            // Apply expand (fill parent along axis)
+            if (expand_of(child).x > 0.f)
+                child.bounds.size.x = std::max(child.bounds.size.x, node.bounds.size.x);
+            if (expand_of(child).y > 0.f)
+                child.bounds.size.y = std::max(child.bounds.size.y, node.bounds.size.y);
 
-            if (expand_axis > 0.f && total_stretch > 0.f)
-                size = (data.direction == Direction::Horizontal
-                            ? float2{size.x + leftover * (stretch_axis / total_stretch), size.y}
-                            : float2{size.x, size.y + leftover * (stretch_axis / total_stretch)});
+            // Wrapping content grows to the height it needs at its width
+            if (node.subtree_wraps)
+                child.bounds.size.y = height_for_width(sys, child, child.bounds.size.x, child.bounds.size.y);
+        }
+    }
 
-            // Assign position and size
-            if (data.direction == Direction::Horizontal) {
-                c.bounds.origin = {cursor, node.bounds.origin.y};
-                c.bounds.size.x = size.x;
-                c.bounds.size.y = std::max(c.bounds.size.y, size.y);
-                cursor += size.x + spacing;
-            } else {
-                c.bounds.origin = {node.bounds.origin.x, cursor};
-                c.bounds.size.y = size.y;
-                c.bounds.size.x = std::max(c.bounds.size.x, size.x);
-                cursor += size.y + spacing;
+
+#if FRAMEFLOW_ENABLE_STACK
+    // Only the active page is placed, at the stack's origin unless its anchors place it
+    static void layout_stack(System *sys, const Node &node, bool mirrored) {
+        const detail::ChildRange children = detail::active_children(sys, node);
+        for (NodeId child_id: children) sys->nodes[child_id.index].bounds.origin = node.bounds.origin;
+        uint8_t anchored_x[1]; // A Stack lays out one page at most
+        resolve_anchors(sys, children, node.bounds, mirrored, anchored_x);
+
+        for (const NodeId &child_id: children) {
+            Node &child = sys->nodes[child_id.index];
+
+            const float2 min_size = resolve_minimum_size(child, node.bounds.size);
+            child.bounds.size.x = std::max(child.bounds.size.x, min_size.x);
+            child.bounds.size.y = std::max(child.bounds.size.y, min_size.y);
+
+            if (expand_of(child).x > 0.f)
+                child.bounds.size.x = std::max(child.bounds.size.x, node.bounds.size.x);
+            if (expand_of(child).y > 0.f)
+                child.bounds.size.y = std::max(child.bounds.size.y, node.bounds.size.y);
+
+            if (node.subtree_wraps)
+                child.bounds.size.y = height_for_width(sys, child, child.bounds.size.x, child.bounds.size.y);
+
+            if (mirrored && !anchored_x[&child_id - children.begin()])
+                child.bounds.origin.x = mirror_x(node.bounds, node.bounds.origin.x, child.bounds.size.x);
+        }
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_MASONRY
+    // Children fill the width of their column, in O(n log K) for n children and K columns.
+    // Only the children appended since the last solve are measured when nothing else changed.
+    static float masonry_child_height(System *sys, const Node &node, Node &child, float column_width) {
+        const float2 size = resolve_minimum_size(child, {column_width, node.bounds.size.y});
+        return height_for_width(sys, child, column_width, size.y);
+    }
+
+    // Whether the height of a child depends on the height of its parent
+    static bool relative_height(const Node &child) {
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+        return child.percent_size.y > 0.f;
+#else
+        (void) child;
+        return false;
+#endif
+    }
+
+    // Put a child of the given height at the top of the shortest column
+    static void place_in_column(const Node &node, const MasonryData &data, MasonryState &state, Node &child,
+                                float height, float column_width, bool mirrored) {
+        std::pop_heap(state.columns.begin(), state.columns.end(), std::greater<>());
+        Column &column = state.columns.back();
+
+        child.bounds.origin = {
+            node.bounds.origin.x + static_cast<float>(column.second) * (column_width + data.spacing),
+            node.bounds.origin.y + column.first
+        };
+        child.bounds.size = {column_width, height};
+        if (mirrored) child.bounds.origin.x = mirror_x(node.bounds, child.bounds.origin.x, column_width);
+
+        column.first += height + data.spacing;
+        std::push_heap(state.columns.begin(), state.columns.end(), std::greater<>());
+    }
+
+    static void layout_masonry(System *sys, const Node &node, const MasonryData &data, MasonryState &state,
+                               bool mirrored) {
+        const float column_width = masonry_column_width(data, node.bounds.size.x);
+        if (!masonry_resumable(node, data, state, node.bounds.size.x)) {
+            reset_columns(state.columns, data.columns);
+            state.heights.clear();
+            state.placed = 0;
+            state.relative = false;
+        } else if (state.bounds.origin.x != node.bounds.origin.x || state.bounds.origin.y != node.bounds.origin.y ||
+                   state.mirrored != mirrored) {
+            // The node moved, the placed children go to the same columns from their stored heights
+            reset_columns(state.columns, data.columns);
+            for (uint32_t i = 0; i < state.placed; ++i) {
+                Node &child = sys->nodes[node.children[i].index];
+                place_in_column(node, data, state, child, state.heights[i], column_width, mirrored);
             }
         }
+
+        for (size_t i = state.placed; i < node.children.size(); ++i) {
+            Node &child = sys->nodes[node.children[i].index];
+            const float height = masonry_child_height(sys, node, child, column_width);
+            state.heights.push_back(height);
+            state.relative = state.relative || relative_height(child);
+            place_in_column(node, data, state, child, height, column_width, mirrored);
+        }
+
+        state.placed = static_cast<uint32_t>(node.children.size());
+        state.last = node.children.empty() ? NullNode : node.children.back();
+        state.bounds = node.bounds;
+        state.data = data;
+        state.mirrored = mirrored;
     }
 
-    static void layout_flow(System *sys, const Node &node, const FlowData &data) {
-        if (node.children.empty()) return;
+    // Placement of a node, its own and its breakpoints', restarts from empty columns
+    static void reset_masonry(System *sys, const Node &node) {
+        if (node.type == NodeType::Masonry) sys->components.masonry_states[node.component_index].placed = 0;
+        const std::vector<Breakpoint> *table = breakpoints_of(sys, node);
+        if (!table) return;
+        for (const Breakpoint &breakpoint: *table)
+            if (breakpoint.type == NodeType::Masonry)
+                sys->components.masonry_states[breakpoint.component_index].placed = 0;
+    }
+#endif
+
+    // Item sizes, expand weights and placed rects of the children of a node, reused between
+    // solves since solvers don't recurse
+    struct ItemScratch {
+        std::vector<float2> sizes;
+        std::vector<float2> expand;
+        std::vector<Rect> rects;
+        std::vector<uint8_t> anchored_x;
+    };
+
+    [[maybe_unused]] static ItemScratch &item_scratch(size_t count) {
+        thread_local ItemScratch scratch;
+        scratch.sizes.clear();
+        scratch.expand.clear();
+        scratch.rects.resize(count);
+        scratch.anchored_x.resize(count);
+        return scratch;
+    }
+
+    [[maybe_unused]] static ItemSpans item_spans(const ItemScratch &scratch) {
+        ItemSpans items;
+        items.count = scratch.sizes.size();
+        items.sizes = scratch.sizes.data();
+        items.expand = scratch.expand.data();
+        return items;
+    }
 
-        float2 offset = node.bounds.origin;
-        float cross_line = 0.f;
+#if FRAMEFLOW_ENABLE_CENTER
+    static void layout_center(System *sys, const Node &node, bool mirrored) {
+        if (node.children.empty()) return;
+        resolve_anchors(sys, all_children(node), node.bounds, mirrored, nullptr);
 
+        ItemScratch &scratch = item_scratch(node.children.size());
         for (NodeId child_id: node.children) {
-            Node &child = *get_node(sys, child_id);
+            Node &child = sys->nodes[child_id.index];
 
-            resolve_anchors(child, node);
+            // Start with minimum size, percentages are relative to the center node.
+            // Children that don't fill the height take the one they need at their width.
+            float2 size = resolve_minimum_size(child, node.bounds.size);
+            const float width = expand_of(child).x > 0.f ? node.bounds.size.x : size.x;
+            if (node.subtree_wraps && !(expand_of(child).y > 0.f)) size.y = height_for_width(sys, child, width, size.y);
 
-            // Start with minimum size
-            float2 size = child.minimum_size;
+            scratch.sizes.push_back(size);
+            scratch.expand.push_back(expand_of(child));
+        }
 
-            // Expand on cross axis only
-            if (data.direction == Direction::Horizontal && child.expand.y > 0.f) size.y = node.bounds.size.y;
-            if (data.direction == Direction::Vertical && child.expand.x > 0.f) size.x = node.bounds.size.x;
+        center_kernel(item_spans(scratch), node.bounds, scratch.rects.data());
+        for (size_t i = 0; i < node.children.size(); i++)
+            sys->nodes[node.children[i].index].bounds = scratch.rects[i];
+    }
+#endif
 
-            // Wrap if necessary
-            if (data.direction == Direction::Horizontal) {
-                float parent_right = node.bounds.origin.x + node.bounds.size.x;
-                if (offset.x + size.x > parent_right) {
-                    offset.x = node.bounds.origin.x;
-                    offset.y += cross_line;
-                    cross_line = 0.f;
-                }
-                child.bounds.origin = offset;
-                child.bounds.size = size;
-                offset.x += size.x;
-                cross_line = std::max(cross_line, size.y);
-            } else {
-                float parent_bottom = node.bounds.origin.y + node.bounds.size.y;
-                if (offset.y + size.y > parent_bottom) {
-                    offset.y = node.bounds.origin.y;
-                    offset.x += cross_line;
-                    cross_line = 0.f;
-                }
-                child.bounds.origin = offset;
-                child.bounds.size = size;
-                offset.y += size.y;
-                cross_line = std::max(cross_line, size.x);
+
+#if FRAMEFLOW_ENABLE_BOX
+    // Main-axis size of a Box child before expanding
+    static float box_child_size(System *sys, const Node &node, const BoxData &data, Node &child,
+                                const float2 &min_size) {
+        if (data.direction == Direction::Horizontal) return min_size.x;
+        if (!child.subtree_wraps) return min_size.y;
+        return height_for_width(sys, child, child_width(sys, child, node.bounds.size.x, min_size.x, false),
+                                min_size.y);
+    }
+
+    static float box_child_size(System *sys, const Node &node, const BoxData &data, Node &child) {
+        return box_child_size(sys, node, data, child, resolve_minimum_size(child, node.bounds.size));
+    }
+
+    // Stretch of a Box child along the main axis, 0 if it doesn't expand
+    static float box_child_weight(const Node &child, const BoxData &data) {
+        const bool horizontal = data.direction == Direction::Horizontal;
+        if ((horizontal ? expand_of(child).x : expand_of(child).y) <= 0.f) return 0.f;
+        return horizontal ? stretch_of(child).x : stretch_of(child).y;
+    }
+
+    // Fenwick trees over the sizes and weights of an index, built in linear time
+    static void build_box_index(BoxIndex &index, const float2 &box_size) {
+        const size_t count = index.sizes.size();
+        index.size_tree.assign(count + 1, 0.0);
+        index.weight_tree.assign(count + 1, 0.0);
+        index.total_size = 0.0;
+        index.total_weight = 0.0;
+        for (size_t i = 1; i <= count; i++) {
+            index.size_tree[i] += index.sizes[i - 1];
+            index.weight_tree[i] += index.weights[i - 1];
+            index.total_size += index.sizes[i - 1];
+            index.total_weight += index.weights[i - 1];
+
+            const size_t parent = i + (i & (~i + 1));
+            if (parent <= count) {
+                index.size_tree[parent] += index.size_tree[i];
+                index.weight_tree[parent] += index.weight_tree[i];
+            }
+        }
+        index.box_size = box_size;
+        index.valid = true;
+    }
+
+    // Per-child inputs of layout_box, reused between calls since it doesn't recurse
+    struct BoxScratch {
+        std::vector<float2> sizes;
+        std::vector<float2> expand;
+        std::vector<float2> stretch;
+    };
+
+    static void layout_box(System *sys, const Node &node, const BoxData &data, BoxIndex *index, bool mirrored) {
+        thread_local BoxScratch scratch;
+        const bool horizontal = data.direction == Direction::Horizontal;
+        resolve_anchors(sys, all_children(node), node.bounds, mirrored, nullptr);
+
+        // Sizes before expanding, across the minimum one (or the width the anchors gave a child
+        // of a column). The index keeps main-axis sizes and stretch per child.
+        const size_t count = node.children.size();
+        scratch.sizes.resize(count);
+        scratch.expand.resize(count);
+        scratch.stretch.resize(count);
+        if (index) {
+            index->sizes.resize(count);
+            index->weights.resize(count);
+        }
+        for (size_t i = 0; i < count; i++) {
+            Node &c = sys->nodes[node.children[i].index];
+            const float2 min_size = resolve_minimum_size(c, node.bounds.size);
+            const float main_size = box_child_size(sys, node, data, c, min_size);
+            scratch.sizes[i] = horizontal ? float2{main_size, min_size.y}
+                                          : float2{std::max(c.bounds.size.x, min_size.x), main_size};
+            scratch.expand[i] = expand_of(c);
+            scratch.stretch[i] = stretch_of(c);
+            if (index) {
+                index->sizes[i] = main_size;
+                index->weights[i] = box_child_weight(c, data);
             }
         }
+        if (index) build_box_index(*index, node.bounds.size);
+        if (count == 0) return;
+
+        ItemSpans items;
+        items.count = count;
+        items.sizes = scratch.sizes.data();
+        items.expand = scratch.expand.data();
+        items.stretch = scratch.stretch.data();
+
+        // Rects go straight into the children. Children of a row take the height they need at
+        // the width they got, or keep the one the anchors gave them; nothing below a Box without
+        // wrapping content is measured. The state is captured as one pointer so PlaceItem
+        // doesn't allocate.
+        struct Placing {
+            System *sys;
+            const Node &node;
+            bool horizontal;
+            bool measure;
+        } placing{sys, node, horizontal, node.subtree_wraps};
+        box_kernel(items, node.bounds, data, mirrored, [p = &placing](size_t i, const Rect &rect) {
+            Node &c = p->sys->nodes[p->node.children[i].index];
+            if (!p->horizontal) {
+                c.bounds = rect;
+                return;
+            }
+            c.bounds.origin = rect.origin;
+            c.bounds.size.x = rect.size.x;
+            const float height = p->measure ? height_for_width(p->sys, c, rect.size.x, rect.size.y) : rect.size.y;
+            c.bounds.size.y = std::max(c.bounds.size.y, height);
+        });
     }
+#endif
 
-    static void layout_margin(System *sys, const Node &node, const MarginData &data) {
+#if FRAMEFLOW_ENABLE_FLOW
+    static void layout_flow(System *sys, const Node &node, const FlowData &data, bool mirrored) {
         if (node.children.empty()) return;
+        resolve_anchors(sys, all_children(node), node.bounds, mirrored, nullptr);
 
-        // Compute inner rect
-        float2 inner_origin{
-            node.bounds.origin.x + data.left,
-            node.bounds.origin.y + data.top
-        };
+        ItemScratch &scratch = item_scratch(node.children.size());
+        for (NodeId child_id: node.children) {
+            Node &child = sys->nodes[child_id.index];
 
-        float2 inner_size{
-            std::max(0.f, node.bounds.size.x - data.left - data.right),
-            std::max(0.f, node.bounds.size.y - data.top - data.bottom)
-        };
+            // Start with minimum size, rows take the height children need at their width
+            float2 size = resolve_minimum_size(child, node.bounds.size);
+            if (data.direction == Direction::Horizontal && !(expand_of(child).y > 0.f))
+                size.y = height_for_width(sys, child, size.x, size.y);
+
+            scratch.sizes.push_back(size);
+            scratch.expand.push_back(expand_of(child));
+        }
+
+        flow_kernel(item_spans(scratch), node.bounds, data, mirrored, scratch.rects.data());
+        for (size_t i = 0; i < node.children.size(); i++)
+            sys->nodes[node.children[i].index].bounds = scratch.rects[i];
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_MARGIN
+    static void layout_margin(System *sys, const Node &node, const MarginData &data, bool mirrored) {
+        if (node.children.empty()) return;
 
+        // Children start at the inner origin unless their anchors place them
+        const Rect inner = margin_inner_rect(node.bounds, data, mirrored);
+        for (NodeId child_id: node.children) sys->nodes[child_id.index].bounds.origin = inner.origin;
+        ItemScratch &scratch = item_scratch(node.children.size());
+        resolve_anchors(sys, all_children(node), inner, mirrored, scratch.anchored_x.data());
+
+        // Apply minimum size, percentages are relative to the inner rect
         for (NodeId child_id: node.children) {
-            Node &child = *get_node(sys, child_id);
+            const Node &child = sys->nodes[child_id.index];
+            const float2 min_size = resolve_minimum_size(child, inner.size);
+            scratch.sizes.push_back({
+                std::max(child.bounds.size.x, min_size.x), std::max(child.bounds.size.y, min_size.y)
+            });
+            scratch.expand.push_back(expand_of(child));
+        }
 
-            // Override parent bounds temporarily
-            Node fake_parent = node;
-            fake_parent.bounds.origin = inner_origin;
-            fake_parent.bounds.size = inner_size;
+        margin_kernel(item_spans(scratch), node.bounds, data, mirrored, scratch.rects.data());
 
-            resolve_anchors(child, fake_parent);
+        for (size_t i = 0; i < node.children.size(); i++) {
+            Node &child = sys->nodes[node.children[i].index];
+            const Rect &rect = scratch.rects[i];
 
-            // Apply minimum size
-            child.bounds.size.x = std::max(child.bounds.size.x, child.minimum_size.x);
-            child.bounds.size.y = std::max(child.bounds.size.y, child.minimum_size.y);
+            // Anchored axes keep the origin the anchors gave them
+            if (!scratch.anchored_x[i]) child.bounds.origin.x = rect.origin.x;
+            child.bounds.size = rect.size;
+            if (node.subtree_wraps)
+                child.bounds.size.y = height_for_width(sys, child, child.bounds.size.x, child.bounds.size.y);
+        }
+    }
+#endif
+
+
+    // Reuse or allocate a component slot
+    template<typename T>
+    static uint32_t acquire_component(std::vector<T> &pool, std::vector<uint32_t> &free_slots, const T &data) {
+        uint32_t comp_idx;
+        if (!free_slots.empty()) {
+            comp_idx = free_slots.back();
+            free_slots.pop_back();
+            pool[comp_idx] = data; // Overwrite old data
+        } else {
+            comp_idx = static_cast<uint32_t>(pool.size());
+            pool.push_back(data);
+        }
+        return comp_idx;
+    }
+
+    static void release_component(System *sys, NodeType type, uint32_t comp_idx) {
+        switch (type) {
+#if FRAMEFLOW_ENABLE_BOX
+            case NodeType::Box:
+                sys->components.free_boxes.push_back(comp_idx);
+                break;
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
+            case NodeType::Flow:
+                sys->components.free_flows.push_back(comp_idx);
+                break;
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
+            case NodeType::Margin:
+                sys->components.free_margins.push_back(comp_idx);
+                break;
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+            case NodeType::Stack:
+                sys->components.free_stacks.push_back(comp_idx);
+                break;
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+            case NodeType::Masonry:
+                sys->components.free_masonries.push_back(comp_idx);
+                break;
+#endif
+#if FRAMEFLOW_ENABLE_EMBED
+            case NodeType::Embed:
+                sys->components.free_embeds.push_back(comp_idx);
+                break;
+#endif
+            default:
+                (void) sys;
+                (void) comp_idx;
+                break;
+        }
+    }
+
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+    static void release_breakpoints(System *sys, Node &node) {
+        if (node.breakpoint_index == NoBreakpoints) return;
+
+        std::vector<Breakpoint> &table = sys->components.breakpoints[node.breakpoint_index];
+        for (const Breakpoint &breakpoint: table)
+            release_component(sys, breakpoint.type, breakpoint.component_index);
+        table.clear(); // Keep capacity for the next node using this slot
+
+        sys->components.free_breakpoints.push_back(node.breakpoint_index);
+        node.breakpoint_index = NoBreakpoints;
+        node.layout_clean = false;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_BOX
+    // Component slot with an index to build
+    static uint32_t acquire_box(System *sys, const BoxData &data) {
+        uint32_t comp_idx = acquire_component(sys->components.boxes, sys->components.free_boxes, data);
+        if (comp_idx == sys->components.box_indices.size()) sys->components.box_indices.emplace_back();
+        sys->components.box_indices[comp_idx].valid = false;
+        return comp_idx;
+    }
+#endif
+
+    // Box indices of a node, its own and its breakpoints', are rebuilt when next used
+    static void drop_box_indices(System *sys, const Node &node) {
+#if FRAMEFLOW_ENABLE_BOX
+        if (node.type == NodeType::Box) sys->components.box_indices[node.component_index].valid = false;
+        const std::vector<Breakpoint> *table = breakpoints_of(sys, node);
+        if (!table) return;
+        for (const Breakpoint &breakpoint: *table)
+            if (breakpoint.type == NodeType::Box) sys->components.box_indices[breakpoint.component_index].valid = false;
+#else
+        (void) sys;
+        (void) node;
+#endif
+    }
+
+    // Drop the measured height of a node, see System::measured
+    static void forget_measure(System *sys, const Node &node) {
+        const auto index = static_cast<size_t>(&node - sys->nodes.data());
+        if (index < sys->measured.size()) sys->measured[index].pass = 0;
+    }
+
+    // The size of node may have changed: its parent places it again. A parent with wrapping
+    // content measures its own height from its children, so its parent does too, and so on up.
+    static void invalidate_ancestors(System *sys, const Node &node) {
+        for (const Node *child = &node; Node *parent = get_node(sys, child->parent); child = parent) {
+            parent->layout_clean = false;
+            forget_measure(sys, *parent);
+#if FRAMEFLOW_ENABLE_MASONRY
+            reset_masonry(sys, *parent);
+#endif
+            if (!parent->subtree_wraps) break;
+        }
+    }
+
+    // Children were added to, removed from or moved out of parent. Call after updating the
+    // aggregates, a subtree bringing wrapping content changes the heights above it.
+    static void children_changed(System *sys, Node &parent) {
+        parent.layout_clean = false;
+        forget_measure(sys, parent);
+        drop_box_indices(sys, parent);
+        if (parent.subtree_wraps) invalidate_ancestors(sys, parent);
+    }
+
+    static bool wrapping_type(NodeType type) {
+        return type == NodeType::Flow || type == NodeType::Masonry;
+    }
+
+    // Whether the node itself measures a height from its width, see Node::subtree_wraps
+    static bool wraps_content(const System *sys, const Node &node) {
+        if (wrapping_type(node.type)) return true;
+        const std::vector<Breakpoint> *table = breakpoints_of(sys, node);
+        if (!table) return false;
+        for (const Breakpoint &breakpoint: *table)
+            if (wrapping_type(breakpoint.type)) return true;
+        return false;
+    }
+
+    // Recompute the aggregates (flags, wrapping content) from id up, stopping at the first
+    // node where they don't change
+    static void refresh_subtree_aggregates(System *sys, NodeId id) {
+        while (Node *node = get_node(sys, id)) {
+#if FRAMEFLOW_ENABLE_FLAGS
+            uint32_t flags = node->flags;
+#else
+            uint32_t flags = 0;
+#endif
+            bool wraps = wraps_content(sys, *node);
+            for (NodeId child_id: node->children) {
+                flags |= subtree_flags_of(sys->nodes[child_id.index]);
+                wraps = wraps || sys->nodes[child_id.index].subtree_wraps;
+            }
+            if (flags == subtree_flags_of(*node) && wraps == node->subtree_wraps) return;
 
-            // Expand behavior
-            if (child.expand.x > 0.f)
-                child.bounds.size.x = std::max(child.bounds.size.x, inner_size.x);
-            if (child.expand.y > 0.f)
-                child.bounds.size.y = std::max(child.bounds.size.y, inner_size.y);
+#if FRAMEFLOW_ENABLE_FLAGS
+            node->subtree_flags = flags;
+#endif
+            node->subtree_wraps = wraps;
+            id = node->parent;
         }
     }
 
+    // Add to the aggregates from id up, no rescan needed
+    static void add_subtree_aggregates(System *sys, NodeId id, uint32_t flags, bool wraps) {
+        for (Node *node = get_node(sys, id);
+             node && ((subtree_flags_of(*node) | flags) != subtree_flags_of(*node) || (wraps && !node->subtree_wraps));
+             node = get_node(sys, node->parent)) {
+#if FRAMEFLOW_ENABLE_FLAGS
+            node->subtree_flags |= flags;
+#endif
+            node->subtree_wraps = node->subtree_wraps || wraps;
+        }
+    }
 
     static NodeId allocate_node(System *sys) {
         uint32_t index;
         uint32_t generation;
 
+        ++sys->structure_version;
+
         if (!sys->free_list.empty()) {
             // Reuse a freed slot
             index = sys->free_list.back();
@@ -229,10 +1043,31 @@ namespace frameflow {
             Node &node = sys->nodes[index];
             node.bounds = {};
             node.minimum_size = {};
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            node.content_extent = {};
+            node.overflow = false;
+#endif
+#if FRAMEFLOW_ENABLE_EXPAND
             node.expand = {0.f, 0.f};
             node.stretch = {1.f, 1.f};
+#endif
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+            node.percent_size = {0.f, 0.f};
+            node.aspect_ratio = 0.f;
+#endif
+            forget_measure(sys, node);
+            node.mirror_x = false;
+            node.share_children = false;
+#if FRAMEFLOW_ENABLE_FLAGS
+            node.flags = 0;
+            node.subtree_flags = 0;
+#endif
+            node.subtree_wraps = false;
+#if FRAMEFLOW_ENABLE_ANCHORS
             node.anchors = {0.f, 0.f, 0.f, 0.f};
             node.offsets = {0.f, 0.f, 0.f, 0.f};
+            node.anchor_target = NullNode;
+#endif
             node.children.clear();
         } else {
             // Allocate new slot
@@ -244,6 +1079,12 @@ namespace frameflow {
         return {index, generation};
     }
 
+    // Typed handles are plain NodeIds underneath, BoxId{id} compiles for any node. The typed
+    // accessors check the node's own type before indexing that type's components with it.
+    [[maybe_unused]] static bool has_type(const System *sys, NodeId id, NodeType type) {
+        return is_valid(sys, id) && sys->nodes[id.index].type == type;
+    }
+
     NodeId add_generic(System *sys, const NodeId parent) {
         // Validate parent
         if (!parent.is_null() && !is_valid(sys, parent)) {
@@ -259,16 +1100,19 @@ namespace frameflow {
         node.parent = parent;
         node.generation = id.generation;
         node.alive = true;
+        node.layout_clean = false;
         node.children.clear();
 
         // Link to parent
         if (!parent.is_null()) {
             sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
         }
 
         return id;
     }
 
+#if FRAMEFLOW_ENABLE_CENTER
     NodeId add_center(System *sys, const NodeId parent) {
         if (!parent.is_null() && !is_valid(sys, parent)) {
             return NullNode;
@@ -283,30 +1127,25 @@ namespace frameflow {
         node.parent = parent;
         node.generation = id.generation;
         node.alive = true;
+        node.layout_clean = false;
         node.children.clear();
 
         if (!parent.is_null()) {
             sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
         }
 
         return id;
     }
+#endif
 
-    NodeId add_box(System *sys, const NodeId parent, const BoxData &data) {
+#if FRAMEFLOW_ENABLE_BOX
+    BoxId add_box(System *sys, const NodeId parent, const BoxData &data) {
         if (!parent.is_null() && !is_valid(sys, parent)) {
-            return NullNode;
+            return BoxId{NullNode};
         }
 
-        // Reuse or allocate component slot
-        size_t comp_idx;
-        if (!sys->components.free_boxes.empty()) {
-            comp_idx = sys->components.free_boxes.back();
-            sys->components.free_boxes.pop_back();
-            sys->components.boxes[comp_idx] = data; // Overwrite old data
-        } else {
-            comp_idx = sys->components.boxes.size();
-            sys->components.boxes.push_back(data);
-        }
+        uint32_t comp_idx = acquire_box(sys, data);
 
         NodeId id = allocate_node(sys);
         Node &node = sys->nodes[id.index];
@@ -318,30 +1157,167 @@ namespace frameflow {
         node.component_index = comp_idx;
         node.generation = id.generation;
         node.alive = true;
+        node.layout_clean = false;
         node.children.clear();
 
         if (!parent.is_null()) {
             sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
         }
 
-        return id;
+        return BoxId{id};
     }
 
-    NodeId add_flow(System *sys, const NodeId parent, const FlowData &data) {
-        if (!parent.is_null() && !is_valid(sys, parent)) {
-            return NullNode;
+    const BoxData *get_box_data(const System *sys, BoxId id) {
+        if (!has_type(sys, id, NodeType::Box)) return nullptr;
+        return &sys->components.boxes[sys->nodes[id.index].component_index];
+    }
+
+    bool set_box_data(System *sys, BoxId id, const BoxData &data) {
+        if (!has_type(sys, id, NodeType::Box)) return false;
+        const uint32_t comp_idx = sys->nodes[id.index].component_index;
+        sys->components.boxes[comp_idx] = data;
+        sys->components.box_indices[comp_idx].valid = false;
+        invalidate_layout(sys, id);
+        return true;
+    }
+
+    static double fenwick_prefix(const std::vector<double> &tree, size_t count) {
+        double sum = 0.0;
+        for (; count > 0; count &= count - 1) sum += tree[count];
+        return sum;
+    }
+
+    static void fenwick_add(std::vector<double> &tree, size_t position, double delta) {
+        for (size_t i = position + 1; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+    }
+
+    // Index of the Box's own data, rebuilt if stale. nullptr if the Box isn't indexed.
+    static BoxIndex *current_box_index(System *sys, const Node &node) {
+        const BoxData &data = sys->components.boxes[node.component_index];
+        if (!data.indexed) return nullptr;
+
+        BoxIndex &index = sys->components.box_indices[node.component_index];
+        if (index.valid && index.box_size.x == node.bounds.size.x && index.box_size.y == node.bounds.size.y)
+            return &index;
+
+        detail::begin_pass(sys);
+        index.sizes.clear();
+        index.weights.clear();
+        for (NodeId child_id: node.children) {
+            Node &child = sys->nodes[child_id.index];
+            index.sizes.push_back(box_child_size(sys, node, data, child));
+            index.weights.push_back(box_child_weight(child, data));
         }
+        build_box_index(index, node.bounds.size);
+        return &index;
+    }
 
-        size_t comp_idx;
-        if (!sys->components.free_flows.empty()) {
-            comp_idx = sys->components.free_flows.back();
-            sys->components.free_flows.pop_back();
-            sys->components.flows[comp_idx] = data;
-        } else {
-            comp_idx = sys->components.flows.size();
-            sys->components.flows.push_back(data);
+    // Where the solver starts, what each unit of stretch gets and the space between children
+    struct BoxSpacing {
+        double start = 0.0;
+        double per_weight = 0.0;
+        double gap = 0.0;
+    };
+
+    static BoxSpacing box_spacing(const Node &node, const BoxData &data, const BoxIndex &index) {
+        const float main_size = data.direction == Direction::Horizontal ? node.bounds.size.x : node.bounds.size.y;
+        const double leftover = std::max(0.0, main_size - index.total_size);
+
+        BoxSpacing spacing;
+        if (index.total_weight > 0.0) spacing.per_weight = leftover / index.total_weight;
+        switch (data.align) {
+            case Align::Start: break;
+            case Align::Center: spacing.start = leftover * 0.5;
+                break;
+            case Align::End: spacing.start = leftover;
+                break;
+            case Align::SpaceBetween:
+                if (index.sizes.size() > 1) spacing.gap = leftover / static_cast<double>(index.sizes.size() - 1);
+                break;
+        }
+        return spacing;
+    }
+
+    uint32_t find_box_child(System *sys, BoxId box, float offset) {
+        if (!has_type(sys, box, NodeType::Box)) return NoChildIndex;
+        const Node &node = sys->nodes[box.index];
+        const BoxIndex *index = current_box_index(sys, node);
+        if (!index || index->sizes.empty()) return NoChildIndex;
+
+        // Descend both trees at once: the children before position end before the target
+        const BoxSpacing spacing = box_spacing(node, sys->components.boxes[node.component_index], *index);
+        const size_t count = index->sizes.size();
+        const double target = offset - spacing.start;
+        size_t step = 1;
+        while (step * 2 <= count) step *= 2;
+
+        size_t position = 0;
+        double end = 0.0;
+        for (; step > 0; step /= 2) {
+            const size_t next = position + step;
+            if (next > count) continue;
+            const double span = index->size_tree[next] + spacing.per_weight * index->weight_tree[next] +
+                                spacing.gap * static_cast<double>(step);
+            if (end + span <= target) {
+                position = next;
+                end += span;
+            }
+        }
+        return static_cast<uint32_t>(std::min(position, count - 1));
+    }
+
+    bool get_box_child_span(System *sys, BoxId box, uint32_t index, float *offset, float *size) {
+        if (!has_type(sys, box, NodeType::Box)) return false;
+        const Node &node = sys->nodes[box.index];
+        const BoxIndex *box_index = current_box_index(sys, node);
+        if (!box_index || index >= box_index->sizes.size()) return false;
+
+        const BoxSpacing spacing = box_spacing(node, sys->components.boxes[node.component_index], *box_index);
+        if (offset) {
+            *offset = static_cast<float>(spacing.start + fenwick_prefix(box_index->size_tree, index) +
+                                         spacing.per_weight * fenwick_prefix(box_index->weight_tree, index) +
+                                         spacing.gap * index);
+        }
+        if (size) {
+            *size = static_cast<float>(box_index->sizes[index] + spacing.per_weight * box_index->weights[index]);
+        }
+        return true;
+    }
+
+    bool update_box_child(System *sys, BoxId box, uint32_t index) {
+        if (!has_type(sys, box, NodeType::Box)) return false;
+        const Node &node = sys->nodes[box.index];
+        BoxIndex *box_index = current_box_index(sys, node);
+        if (!box_index || index >= box_index->sizes.size()) return false;
+
+        const NodeId child_id = node.children[index];
+        Node &child = sys->nodes[child_id.index];
+        const BoxData &data = sys->components.boxes[node.component_index];
+        detail::begin_pass(sys);
+        const float size = box_child_size(sys, node, data, child);
+        const float weight = box_child_weight(child, data);
+
+        fenwick_add(box_index->size_tree, index, size - box_index->sizes[index]);
+        fenwick_add(box_index->weight_tree, index, weight - box_index->weights[index]);
+        box_index->total_size += size - box_index->sizes[index];
+        box_index->total_weight += weight - box_index->weights[index];
+        box_index->sizes[index] = size;
+        box_index->weights[index] = weight;
+
+        invalidate_layout(sys, child_id);
+        return true;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_FLOW
+    FlowId add_flow(System *sys, const NodeId parent, const FlowData &data) {
+        if (!parent.is_null() && !is_valid(sys, parent)) {
+            return FlowId{NullNode};
         }
 
+        uint32_t comp_idx = acquire_component(sys->components.flows, sys->components.free_flows, data);
+
         NodeId id = allocate_node(sys);
         Node &node = sys->nodes[id.index];
 
@@ -352,29 +1328,38 @@ namespace frameflow {
         node.component_index = comp_idx;
         node.generation = id.generation;
         node.alive = true;
+        node.layout_clean = false;
         node.children.clear();
 
+        add_subtree_aggregates(sys, id, 0, true);
         if (!parent.is_null()) {
             sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
         }
 
-        return id;
+        return FlowId{id};
+    }
+
+    const FlowData *get_flow_data(const System *sys, FlowId id) {
+        if (!has_type(sys, id, NodeType::Flow)) return nullptr;
+        return &sys->components.flows[sys->nodes[id.index].component_index];
+    }
+
+    bool set_flow_data(System *sys, FlowId id, const FlowData &data) {
+        if (!has_type(sys, id, NodeType::Flow)) return false;
+        sys->components.flows[sys->nodes[id.index].component_index] = data;
+        invalidate_layout(sys, id);
+        return true;
     }
+#endif
 
-    NodeId add_margin(System *sys, const NodeId parent, const MarginData &data) {
+#if FRAMEFLOW_ENABLE_MARGIN
+    MarginId add_margin(System *sys, const NodeId parent, const MarginData &data) {
         if (!parent.is_null() && !is_valid(sys, parent)) {
-            return NullNode;
+            return MarginId{NullNode};
         }
 
-        size_t comp_idx;
-        if (!sys->components.free_margins.empty()) {
-            comp_idx = sys->components.free_margins.back();
-            sys->components.free_margins.pop_back();
-            sys->components.margins[comp_idx] = data;
-        } else {
-            comp_idx = sys->components.margins.size();
-            sys->components.margins.push_back(data);
-        }
+        uint32_t comp_idx = acquire_component(sys->components.margins, sys->components.free_margins, data);
 
         NodeId id = allocate_node(sys);
         Node &node = sys->nodes[id.index];
@@ -386,15 +1371,185 @@ namespace frameflow {
         node.component_index = comp_idx;
         node.generation = id.generation;
         node.alive = true;
+        node.layout_clean = false;
         node.children.clear();
 
         if (!parent.is_null()) {
             sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
         }
 
-        return id;
+        return MarginId{id};
     }
 
+    const MarginData *get_margin_data(const System *sys, MarginId id) {
+        if (!has_type(sys, id, NodeType::Margin)) return nullptr;
+        return &sys->components.margins[sys->nodes[id.index].component_index];
+    }
+
+    bool set_margin_data(System *sys, MarginId id, const MarginData &data) {
+        if (!has_type(sys, id, NodeType::Margin)) return false;
+        sys->components.margins[sys->nodes[id.index].component_index] = data;
+        invalidate_layout(sys, id);
+        return true;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_STACK
+    // Component slot and a state without page hashes
+    static uint32_t acquire_stack(System *sys, const StackData &data) {
+        uint32_t comp_idx = acquire_component(sys->components.stacks, sys->components.free_stacks, data);
+        if (comp_idx == sys->components.stack_states.size()) sys->components.stack_states.emplace_back();
+        sys->components.stack_states[comp_idx].pages.clear();
+        return comp_idx;
+    }
+
+    StackId add_stack(System *sys, const NodeId parent, const StackData &data) {
+        if (!parent.is_null() && !is_valid(sys, parent)) {
+            return StackId{NullNode};
+        }
+
+        uint32_t comp_idx = acquire_stack(sys, data);
+
+        NodeId id = allocate_node(sys);
+        Node &node = sys->nodes[id.index];
+
+        node.type = NodeType::Stack;
+        node.bounds = {};
+        node.minimum_size = {};
+        node.parent = parent;
+        node.component_index = comp_idx;
+        node.generation = id.generation;
+        node.alive = true;
+        node.layout_clean = false;
+        node.children.clear();
+
+        if (!parent.is_null()) {
+            sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
+        }
+
+        return StackId{id};
+    }
+
+    bool set_active_page(System *sys, StackId stack, uint32_t index) {
+        Node *node = get_node(sys, stack);
+        if (!node || node->type != NodeType::Stack) return false;
+
+        sys->components.stacks[node->component_index].active = index;
+        node->layout_clean = false;
+        return true;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_MASONRY
+    // Component slot and a placement state starting from empty columns
+    static uint32_t acquire_masonry(System *sys, const MasonryData &data) {
+        uint32_t comp_idx = acquire_component(sys->components.masonries, sys->components.free_masonries, data);
+        if (comp_idx == sys->components.masonry_states.size()) sys->components.masonry_states.emplace_back();
+        sys->components.masonry_states[comp_idx].placed = 0;
+        return comp_idx;
+    }
+
+    MasonryId add_masonry(System *sys, const NodeId parent, const MasonryData &data) {
+        if (!parent.is_null() && !is_valid(sys, parent)) {
+            return MasonryId{NullNode};
+        }
+
+        uint32_t comp_idx = acquire_masonry(sys, data);
+
+        NodeId id = allocate_node(sys);
+        Node &node = sys->nodes[id.index];
+
+        node.type = NodeType::Masonry;
+        node.bounds = {};
+        node.minimum_size = {};
+        node.parent = parent;
+        node.component_index = comp_idx;
+        node.generation = id.generation;
+        node.alive = true;
+        node.layout_clean = false;
+        node.children.clear();
+
+        add_subtree_aggregates(sys, id, 0, true);
+        if (!parent.is_null()) {
+            sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
+        }
+
+        return MasonryId{id};
+    }
+
+    const MasonryData *get_masonry_data(const System *sys, MasonryId id) {
+        if (!has_type(sys, id, NodeType::Masonry)) return nullptr;
+        return &sys->components.masonries[sys->nodes[id.index].component_index];
+    }
+
+    bool set_masonry_data(System *sys, MasonryId id, const MasonryData &data) {
+        if (!has_type(sys, id, NodeType::Masonry)) return false;
+        sys->components.masonries[sys->nodes[id.index].component_index] = data;
+        invalidate_layout(sys, id);
+        return true;
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_EMBED
+    EmbedId add_embed(System *sys, const NodeId parent, const EmbedData &data) {
+        if (!parent.is_null() && !is_valid(sys, parent)) {
+            return EmbedId{NullNode};
+        }
+
+        uint32_t comp_idx = acquire_component(sys->components.embeds, sys->components.free_embeds, data);
+
+        NodeId id = allocate_node(sys);
+        Node &node = sys->nodes[id.index];
+
+        node.type = NodeType::Embed;
+        node.bounds = {};
+        node.minimum_size = {};
+        node.parent = parent;
+        node.component_index = comp_idx;
+        node.generation = id.generation;
+        node.alive = true;
+        node.layout_clean = false;
+        node.children.clear();
+
+        if (!parent.is_null()) {
+            sys->nodes[parent.index].children.push_back(id);
+            children_changed(sys, sys->nodes[parent.index]);
+        }
+
+        return EmbedId{id};
+    }
+
+    const EmbedData *get_embed_data(const System *sys, EmbedId id) {
+        if (!has_type(sys, id, NodeType::Embed)) return nullptr;
+        return &sys->components.embeds[sys->nodes[id.index].component_index];
+    }
+
+    bool set_embed_data(System *sys, EmbedId id, const EmbedData &data) {
+        if (!has_type(sys, id, NodeType::Embed)) return false;
+        sys->components.embeds[sys->nodes[id.index].component_index] = data;
+        return true;
+    }
+
+    bool sync_embed(System *sys, EmbedId id) {
+        if (!has_type(sys, id, NodeType::Embed)) return false;
+        const Node &node = sys->nodes[id.index];
+        const EmbedData &data = sys->components.embeds[node.component_index];
+        Node *root = data.system ? get_node(data.system, data.root) : nullptr;
+        if (!root) return false;
+
+        const Rect bounds{{0.f, 0.f}, node.bounds.size};
+        if (root->bounds.origin.x == bounds.origin.x && root->bounds.origin.y == bounds.origin.y &&
+            root->bounds.size.x == bounds.size.x && root->bounds.size.y == bounds.size.y)
+            return false;
+        root->bounds = bounds;
+        invalidate_layout(data.system, data.root);
+        return true;
+    }
+#endif
+
     bool is_valid(const System *sys, NodeId id) {
         if (id.is_null()) return false;
         if (id.index >= sys->nodes.size()) return false;
@@ -418,31 +1573,35 @@ namespace frameflow {
         return false;
     }
 
-    bool delete_node(System *sys, NodeId id) {
+    static bool delete_recursive(System *sys, NodeId id, detail::ChildListGarbage *garbage) {
         if (!is_valid(sys, id)) return false;
 
         Node &node = sys->nodes[id.index];
 
         // 1. Recursively delete all children first
-        std::vector<NodeId> children_copy = node.children;
-        for (NodeId child_id : children_copy) {
-            delete_node(sys, child_id);
+        if (garbage) {
+            // Hand the children storage to the caller instead of keeping it for slot reuse
+            std::vector<NodeId> children = std::move(node.children);
+            node.children = {};
+            for (NodeId child_id : children) {
+                delete_recursive(sys, child_id, garbage);
+            }
+            garbage->push_back(std::move(children));
+        } else {
+            std::vector<NodeId> children_copy = node.children;
+            for (NodeId child_id : children_copy) {
+                delete_recursive(sys, child_id, nullptr);
+            }
         }
 
         // 2. Free component data if this node has any
-        switch (node.type) {
-            case NodeType::Box:
-                sys->components.free_boxes.push_back(node.component_index);
-                break;
-            case NodeType::Flow:
-                sys->components.free_flows.push_back(node.component_index);
-                break;
-            case NodeType::Margin:
-                sys->components.free_margins.push_back(node.component_index);
-                break;
-            default:
-                break;
-        }
+        release_component(sys, node.type, node.component_index);
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+        release_breakpoints(sys, node);
+#endif
+#if FRAMEFLOW_ENABLE_ANCHORS
+        if (!sys->anchor_links.empty()) unlink_anchors(sys, id);
+#endif
 
         // 3. Remove from parent's children list
         if (!node.parent.is_null()) {
@@ -452,6 +1611,7 @@ namespace frameflow {
                 if (it != parent->children.end()) {
                     parent->children.erase(it);
                 }
+                children_changed(sys, *parent);
             }
         }
 
@@ -467,6 +1627,23 @@ namespace frameflow {
         return true;
     }
 
+    bool detail::delete_subtree(System *sys, NodeId id, ChildListGarbage *garbage) {
+        if (!is_valid(sys, id)) return false;
+
+        ++sys->structure_version;
+
+        // Ancestors only need their flags recomputed once, not for every deleted node
+        const NodeId parent = sys->nodes[id.index].parent;
+        const bool flagged = subtree_flags_of(sys->nodes[id.index]) != 0 || sys->nodes[id.index].subtree_wraps;
+        delete_recursive(sys, id, garbage);
+        if (flagged) refresh_subtree_aggregates(sys, parent);
+        return true;
+    }
+
+    bool delete_node(System *sys, NodeId id) {
+        return detail::delete_subtree(sys, id, nullptr);
+    }
+
     bool reparent_node(System *sys, NodeId node_id, NodeId new_parent) {
         // Validate both nodes exist
         if (!is_valid(sys, node_id)) return false;
@@ -490,20 +1667,193 @@ namespace frameflow {
                 if (it != old_parent->children.end()) {
                     old_parent->children.erase(it);
                 }
+                children_changed(sys, *old_parent);
             }
         }
+        if (subtree_flags_of(node) || node.subtree_wraps) refresh_subtree_aggregates(sys, node.parent);
 
         // 2. Add to new parent's children list
+        add_subtree_aggregates(sys, new_parent, subtree_flags_of(node), node.subtree_wraps);
         if (!new_parent.is_null()) {
             sys->nodes[new_parent.index].children.push_back(node_id);
+            children_changed(sys, sys->nodes[new_parent.index]);
         }
+        node.layout_clean = false;
 
         // 3. Update parent reference
         node.parent = new_parent;
+        ++sys->structure_version;
 
         return true;
     }
 
+    // Copy the component data of a node into another System, returns its slot there
+    static uint32_t transfer_component(const System *from, System *to, NodeType type, uint32_t comp_idx) {
+        switch (type) {
+#if FRAMEFLOW_ENABLE_BOX
+            case NodeType::Box:
+                return acquire_box(to, from->components.boxes[comp_idx]);
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
+            case NodeType::Flow:
+                return acquire_component(to->components.flows, to->components.free_flows,
+                                         from->components.flows[comp_idx]);
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
+            case NodeType::Margin:
+                return acquire_component(to->components.margins, to->components.free_margins,
+                                         from->components.margins[comp_idx]);
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+            case NodeType::Stack:
+                return acquire_stack(to, from->components.stacks[comp_idx]);
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+            case NodeType::Masonry:
+                return acquire_masonry(to, from->components.masonries[comp_idx]);
+#endif
+#if FRAMEFLOW_ENABLE_EMBED
+            case NodeType::Embed:
+                return acquire_component(to->components.embeds, to->components.free_embeds,
+                                         from->components.embeds[comp_idx]);
+#endif
+            default:
+                (void) from;
+                (void) to;
+                return comp_idx;
+        }
+    }
+
+    // Mapping tables are sorted by old index, which is unique within the source System
+    static bool mapping_before(const NodeMapping &a, const NodeMapping &b) {
+        return a.from.index < b.from.index;
+    }
+
+    static bool mapping_less(const NodeMapping &entry, uint32_t index) {
+        return entry.from.index < index;
+    }
+
+    std::vector<NodeMapping> transfer_subtree(System *from, NodeId id, System *to, NodeId new_parent) {
+        std::vector<NodeMapping> mapping;
+        if (!is_valid(from, id)) return mapping;
+        if (!new_parent.is_null() && !is_valid(to, new_parent)) return mapping;
+
+        if (from == to) {
+            // Handles stay valid, the table maps every node to itself
+            if (!reparent_node(from, id, new_parent)) return mapping;
+            mapping.push_back({id, id});
+            for (size_t i = 0; i < mapping.size(); i++)
+                for (NodeId child: from->nodes[mapping[i].from.index].children) mapping.push_back({child, child});
+            std::sort(mapping.begin(), mapping.end(), mapping_before);
+            return mapping;
+        }
+
+        // 1. Allocate the new records breadth-first, so the children of each node are
+        // consecutive entries, in order, following the children of the nodes before it
+        mapping.push_back({id, allocate_node(to)});
+        for (size_t i = 0; i < mapping.size(); i++)
+            for (NodeId child: from->nodes[mapping[i].from.index].children) mapping.push_back({child, allocate_node(to)});
+
+        // 2. Detach the subtree in from
+        ++from->structure_version;
+        Node &root = from->nodes[id.index];
+        const NodeId old_parent_id = root.parent;
+        const uint32_t flags = subtree_flags_of(root);
+        const bool wraps = root.subtree_wraps;
+        if (Node *old_parent = get_node(from, root.parent)) {
+            auto it = std::find(old_parent->children.begin(), old_parent->children.end(), id);
+            if (it != old_parent->children.end()) old_parent->children.erase(it);
+            children_changed(from, *old_parent);
+        }
+
+        // 3. Move the records and their component data, freeing the old slots
+        size_t next = 1;
+        for (const NodeMapping &entry: mapping) {
+            Node &old_node = from->nodes[entry.from.index];
+            Node &node = to->nodes[entry.to.index];
+
+            node = std::move(old_node);
+            node.generation = entry.to.generation;
+            for (NodeId &child: node.children) child = mapping[next++].to;
+
+            node.component_index = transfer_component(from, to, node.type, old_node.component_index);
+            release_component(from, node.type, old_node.component_index);
+
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+            if (old_node.breakpoint_index != NoBreakpoints) {
+                std::vector<Breakpoint> &old_table = from->components.breakpoints[old_node.breakpoint_index];
+                node.breakpoint_index = acquire_component(to->components.breakpoints,
+                                                          to->components.free_breakpoints, {});
+                std::vector<Breakpoint> &table = to->components.breakpoints[node.breakpoint_index];
+                for (Breakpoint breakpoint: old_table) {
+                    const uint32_t comp_idx = breakpoint.component_index;
+                    breakpoint.component_index = transfer_component(from, to, breakpoint.type, comp_idx);
+                    release_component(from, breakpoint.type, comp_idx);
+                    table.push_back(breakpoint);
+                }
+                old_table.clear();
+                from->components.free_breakpoints.push_back(old_node.breakpoint_index);
+            }
+            old_node.breakpoint_index = NoBreakpoints;
+#endif
+
+            // Pass numbers and cached results belong to the other System
+            node.layout_clean = false;
+
+            old_node.alive = false;
+            old_node.generation++;
+            old_node.children.clear();
+            old_node.parent = NullNode;
+            from->free_list.push_back(entry.from.index);
+        }
+        if (flags || wraps) refresh_subtree_aggregates(from, old_parent_id);
+
+        // 4. Link the parents in to
+        for (const NodeMapping &entry: mapping)
+            for (NodeId child: to->nodes[entry.to.index].children) to->nodes[child.index].parent = entry.to;
+
+        const NodeId new_root = mapping.front().to;
+        to->nodes[new_root.index].parent = new_parent;
+        add_subtree_aggregates(to, new_parent, flags, wraps);
+        if (!new_parent.is_null()) {
+            to->nodes[new_parent.index].children.push_back(new_root);
+            children_changed(to, to->nodes[new_parent.index]);
+        }
+
+        std::sort(mapping.begin(), mapping.end(), mapping_before);
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+        // Links inside the subtree move with it, links crossing its border are dropped
+        std::vector<AnchorLink> &links = from->anchor_links;
+        for (size_t i = 0; i < links.size();) {
+            const NodeId dependent = remap_node(mapping, links[i].dependent);
+            const NodeId target = remap_node(mapping, links[i].target);
+            if (dependent.is_null() && target.is_null()) {
+                i++;
+                continue;
+            }
+
+            if (dependent.is_null()) {
+                from->nodes[links[i].dependent.index].anchor_target = NullNode;
+                invalidate_layout(from, links[i].dependent);
+            } else {
+                to->nodes[dependent.index].anchor_target = target;
+                if (!target.is_null()) to->anchor_links.push_back({target, dependent, {}});
+            }
+            links[i] = links.back();
+            links.pop_back();
+        }
+#endif
+
+        return mapping;
+    }
+
+    NodeId remap_node(const std::vector<NodeMapping> &mapping, NodeId old_id) {
+        auto it = std::lower_bound(mapping.begin(), mapping.end(), old_id.index, mapping_less);
+        if (it == mapping.end() || it->from != old_id) return NullNode;
+        return it->to;
+    }
+
     // This could be a bad reference after the end of the frame.
     // Make sure you're storing handles, and not Node references.
     // Might be more aptly named "GetTemporaryNode"
@@ -517,29 +1867,909 @@ namespace frameflow {
         return &sys->nodes[id.index];
     }
 
-    void compute_layout(System *sys, const NodeId node_id) {
-        Node *node = get_node(sys, node_id);
-        if (!node) return;
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+    static bool push_breakpoint(System *sys, NodeId id, const Breakpoint &breakpoint) {
+        Node *node = get_node(sys, id);
+        if (!node) return false;
+
+        if (node->breakpoint_index == NoBreakpoints) {
+            node->breakpoint_index = acquire_component(sys->components.breakpoints,
+                                                       sys->components.free_breakpoints, {});
+        }
+        sys->components.breakpoints[node->breakpoint_index].push_back(breakpoint);
+        ++sys->structure_version; // Compiled tapes resolve the solver of nodes without breakpoints
+        add_subtree_aggregates(sys, id, 0, wrapping_type(breakpoint.type));
+        invalidate_layout(sys, id);
+        return true;
+    }
+
+    bool add_breakpoint(System *sys, NodeId id, float min_width, float max_width, NodeType type) {
+        // Types with component data have their own overloads
+        if (type != NodeType::Generic && !(FRAMEFLOW_ENABLE_CENTER && type == NodeType::Center)) return false;
+        return push_breakpoint(sys, id, {min_width, max_width, type, 0});
+    }
+
+#if FRAMEFLOW_ENABLE_BOX
+    bool add_box_breakpoint(System *sys, NodeId id, float min_width, float max_width, const BoxData &data) {
+        if (!is_valid(sys, id)) return false;
+        uint32_t comp_idx = acquire_box(sys, data);
+        return push_breakpoint(sys, id, {min_width, max_width, NodeType::Box, comp_idx});
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_FLOW
+    bool add_flow_breakpoint(System *sys, NodeId id, float min_width, float max_width, const FlowData &data) {
+        if (!is_valid(sys, id)) return false;
+        uint32_t comp_idx = acquire_component(sys->components.flows, sys->components.free_flows, data);
+        return push_breakpoint(sys, id, {min_width, max_width, NodeType::Flow, comp_idx});
+    }
+#endif
+
+#if FRAMEFLOW_ENABLE_MARGIN
+    bool add_margin_breakpoint(System *sys, NodeId id, float min_width, float max_width, const MarginData &data) {
+        if (!is_valid(sys, id)) return false;
+        uint32_t comp_idx = acquire_component(sys->components.margins, sys->components.free_margins, data);
+        return push_breakpoint(sys, id, {min_width, max_width, NodeType::Margin, comp_idx});
+    }
+#endif
+
+    bool clear_breakpoints(System *sys, NodeId id) {
+        Node *node = get_node(sys, id);
+        if (!node) return false;
+        if (node->breakpoint_index == NoBreakpoints) return true;
+
+        // Ancestors measuring the node still wrap at this point and are all reached
+        invalidate_layout(sys, id);
+        release_breakpoints(sys, *node);
+        refresh_subtree_aggregates(sys, id);
+        ++sys->structure_version;
+        return true;
+    }
+#endif
+
+    Rect detail::rect_union(const Rect &a, const Rect &b) {
+        const float2 min = float2::min(a.origin, b.origin);
+        const float2 max = float2::max(a.origin + a.size, b.origin + b.size);
+        return {min, max - min};
+    }
 
-        switch (node->type) {
-            case NodeType::Generic: layout_generic(sys, *node);
+    // Tolerates rounding in the positions containers accumulate
+    constexpr float OverflowTolerance = 1e-3f;
+
+    void detail::set_content_extent(Node &node, const Rect &extent) {
+#if !FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        (void) node;
+        (void) extent;
+#else
+        const float2 content_end = extent.origin + extent.size;
+        const float2 end = node.bounds.origin + node.bounds.size;
+        const bool overflow = extent.origin.x < node.bounds.origin.x - OverflowTolerance ||
+                              extent.origin.y < node.bounds.origin.y - OverflowTolerance ||
+                              content_end.x > end.x + OverflowTolerance ||
+                              content_end.y > end.y + OverflowTolerance;
+
+        // Unchanged results aren't stored again, see solve_as
+        const Rect &current = node.content_extent;
+        if (current.origin.x != extent.origin.x || current.origin.y != extent.origin.y ||
+            current.size.x != extent.size.x || current.size.y != extent.size.y)
+            node.content_extent = extent;
+        if (node.overflow != overflow) node.overflow = overflow;
+#endif
+    }
+
+    // Type and component a node is laid out with at width
+    static Breakpoint variant_at(const System *sys, const Node &node, float width) {
+        if (const std::vector<Breakpoint> *table = breakpoints_of(sys, node)) {
+            for (const Breakpoint &breakpoint: *table) {
+                if (width >= breakpoint.min_width && width < breakpoint.max_width) return breakpoint;
+            }
+        }
+        return {0.f, 0.f, node.type, node.component_index};
+    }
+
+    Breakpoint detail::active_variant(const System *sys, const Node &node) {
+        return variant_at(sys, node, node.bounds.size.x);
+    }
+
+    // Children a node laid out as variant places
+    static detail::ChildRange children_as(const System *sys, const Node &node, const Breakpoint &variant) {
+        const NodeId *first = node.children.data();
+        const NodeId *last = first + node.children.size();
+#if FRAMEFLOW_ENABLE_EMBED
+        // The contents of an Embed are in the other System
+        if (node.type == NodeType::Embed) return {last, last};
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+        if (variant.type == NodeType::Stack) {
+            // An out of range page shows nothing
+            const uint32_t active = sys->components.stacks[variant.component_index].active;
+            if (active >= node.children.size()) return {last, last};
+            return {first + active, first + active + 1};
+        }
+#else
+        (void) sys;
+        (void) variant;
+#endif
+        return {first, last};
+    }
+
+    detail::ChildRange detail::active_children(const System *sys, const Node &node) {
+        return children_as(sys, node, detail::active_variant(sys, node));
+    }
+
+    detail::ChildRange detail::children_at(const System *sys, const Node &node, float width) {
+        return children_as(sys, node, variant_at(sys, node, width));
+    }
+
+    NodeType get_active_type(const System *sys, NodeId id) {
+        const Node *node = get_node(sys, id);
+        if (!node) return NodeType::Generic;
+        return detail::active_variant(sys, *node).type;
+    }
+
+    detail::ChildRange detail::solve_as(System *sys, Node &node, const Breakpoint &variant, bool mirrored) {
+        switch (variant.type) {
+            case NodeType::Generic: layout_generic(sys, node, mirrored);
                 break;
+#if FRAMEFLOW_ENABLE_CENTER
             case NodeType::Center:
-                layout_center(sys, *node);
+                layout_center(sys, node, mirrored);
                 break;
-            case NodeType::Box:
-                layout_box(sys, *node, sys->components.boxes[node->component_index]);
+#endif
+#if FRAMEFLOW_ENABLE_BOX
+            case NodeType::Box: {
+                const BoxData &data = sys->components.boxes[variant.component_index];
+                BoxIndex *index = data.indexed ? &sys->components.box_indices[variant.component_index] : nullptr;
+                layout_box(sys, node, data, index, mirrored);
                 break;
+            }
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
             case NodeType::Flow:
-                layout_flow(sys, *node, sys->components.flows[node->component_index]);
+                layout_flow(sys, node, sys->components.flows[variant.component_index], mirrored);
                 break;
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
             case NodeType::Margin:
-                layout_margin(sys, *node, sys->components.margins[node->component_index]);
+                layout_margin(sys, node, sys->components.margins[variant.component_index], mirrored);
+                break;
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+            case NodeType::Stack:
+                layout_stack(sys, node, mirrored);
                 break;
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+            case NodeType::Masonry: {
+                // Without fast paths, place everything and leave the stored progress alone
+                MasonryState scratch;
+                MasonryState &stored = sys->components.masonry_states[variant.component_index];
+                layout_masonry(sys, node, sys->components.masonries[variant.component_index],
+                               sys->fast_paths ? stored : scratch, mirrored);
+                break;
+            }
+#endif
             default: break;
         }
 
-        for (const auto child_id: node->children)
-            compute_layout(sys, child_id);
+        // Content extent from the children's bounds, see include_child_extents
+        const detail::ChildRange children = children_as(sys, node, variant);
+        Rect extent{node.bounds.origin, {0.f, 0.f}};
+        bool first = true;
+        for (NodeId child_id: children) {
+            const Rect &bounds = sys->nodes[child_id.index].bounds;
+            extent = first ? bounds : detail::rect_union(extent, bounds);
+            first = false;
+        }
+        detail::set_content_extent(node, extent);
+
+        // Unchanged state isn't stored again, relayouts then leave most cache lines clean
+        if (!node.layout_clean) node.layout_clean = true;
+        return children;
+    }
+
+    void detail::solve_leaf(Node &node) {
+        detail::set_content_extent(node, {node.bounds.origin, {0.f, 0.f}});
+        if (!node.layout_clean) node.layout_clean = true;
+    }
+
+    void detail::solve_node(System *sys, Node &node, bool mirrored) {
+        // Children moved, so whatever they placed below them is stale. layout_subtree solves
+        // them right away and doesn't need to mark them.
+        for (NodeId child_id: detail::solve_as(sys, node, detail::active_variant(sys, node), mirrored))
+            sys->nodes[child_id.index].layout_clean = false;
+    }
+
+    bool detail::is_mirrored(const System *sys, const Node &node) {
+        for (const Node *n = &node; ; n = &sys->nodes[n->parent.index]) {
+            if (n->mirror_x) return true;
+            if (n->parent.is_null()) return false;
+        }
+    }
+
+    // Make sure the bounds of a node are final by re-solving only the dirty ancestors
+    // on the path from its root. Roots are placed by the host.
+    // Returns whether the node's subtree is laid out right-to-left.
+    static bool ensure_placed(System *sys, const Node &node) {
+        if (node.parent.is_null()) return node.mirror_x;
+
+        Node &parent = sys->nodes[node.parent.index];
+        const bool parent_mirrored = ensure_placed(sys, parent);
+        if (!parent.layout_clean) detail::solve_node(sys, parent, parent_mirrored);
+        return parent_mirrored || node.mirror_x;
+    }
+
+    // Whether a child's horizontal position comes from its parent's solver.
+    // Generic children without horizontal anchors keep the origin the host gave them.
+    static bool solver_places_x(const System *sys, const Node &parent, const Node &child) {
+        if (detail::active_variant(sys, parent).type != NodeType::Generic) return true;
+        return anchored_width(sys, child, parent.bounds.size.x) > 0.f;
+    }
+
+    // Rects of the children being moved by move_children, nested calls push theirs after the
+    // ones of their ancestors
+    static thread_local std::vector<Rect> moved_rects;
+
+    // Follow a node that moved from old_x: the children its solver places move with it, and are
+    // reflected inside it if reflect. Below a child with mirror_x of its own the direction doesn't
+    // change, the subtree is only translated. Inactive pages are left alone like a relayout would.
+    static void move_children(System *sys, Node &node, float old_x, bool reflect) {
+        const float dx = node.bounds.origin.x - old_x;
+        if (!reflect && dx == 0.f) return;
+
+        const detail::ChildRange children = detail::active_children(sys, node);
+        const auto count = static_cast<size_t>(children.end() - children.begin());
+        std::vector<Rect> &rects = moved_rects;
+        const size_t first = rects.size();
+        for (NodeId child_id: children) {
+            const Node &child = sys->nodes[child_id.index];
+
+            // Anchor targets aren't moved along, their dependents are solved again
+            if (has_anchor_target(child)) node.layout_clean = false;
+            rects.push_back(child.bounds);
+        }
+        translate_rects(rects.data() + first, count, dx, 0.f);
+        if (reflect) mirror_rects(rects.data() + first, count, node.bounds.origin.x, node.bounds.size.x);
+
+        for (size_t i = 0; i < count; i++) {
+            Node &child = sys->nodes[children.begin()[i].index];
+            const float child_old_x = child.bounds.origin.x;
+            if (solver_places_x(sys, node, child)) child.bounds.origin.x = rects[first + i].origin.x;
+            move_children(sys, child, child_old_x, reflect && !child.mirror_x);
+        }
+        rects.resize(first);
+
+        Rect extent{node.bounds.origin, {0.f, 0.f}};
+        for (size_t i = 0; i < count; i++) {
+            const Rect &child_bounds = sys->nodes[children.begin()[i].index].bounds;
+            extent = i == 0 ? child_bounds : detail::rect_union(extent, child_bounds);
+        }
+        detail::set_content_extent(node, extent);
+        detail::include_child_extents(sys, node);
+    }
+
+    bool set_mirror_x(System *sys, NodeId id, bool mirror) {
+        Node *node = get_node(sys, id);
+        if (!node) return false;
+
+        const bool was_mirrored = detail::is_mirrored(sys, *node);
+        node->mirror_x = mirror;
+        if (detail::is_mirrored(sys, *node) == was_mirrored) return true;
+
+        // The node keeps its own bounds, everything below it is reflected. Dirty containers
+        // re-solve their children on the next layout anyway, so this matches a full relayout.
+        move_children(sys, *node, node->bounds.origin.x, true);
+        return true;
+    }
+
+#if FRAMEFLOW_ENABLE_FLAGS
+    // ========== User flags ==========
+
+    bool set_node_flags(System *sys, NodeId id, uint32_t flags) {
+        Node *node = get_node(sys, id);
+        if (!node) return false;
+
+        const bool cleared = (node->flags & ~flags) != 0;
+        node->flags = flags;
+        if (cleared) refresh_subtree_aggregates(sys, id);
+        else add_subtree_aggregates(sys, id, flags, false);
+        return true;
+    }
+
+    static void find_recursive(const System *sys, NodeId id, uint32_t mask, std::vector<NodeId> *out) {
+        const Node &node = sys->nodes[id.index];
+        if ((node.subtree_flags & mask) != mask) return;
+
+        if ((node.flags & mask) == mask) out->push_back(id);
+        for (NodeId child_id: node.children) find_recursive(sys, child_id, mask, out);
+    }
+
+    bool find_nodes(const System *sys, NodeId root, uint32_t mask, std::vector<NodeId> *out) {
+        if (!is_valid(sys, root)) return false;
+        find_recursive(sys, root, mask, out);
+        return true;
+    }
+
+    static bool contains(const Rect &rect, const float2 &point) {
+        return point.x >= rect.origin.x && point.y >= rect.origin.y &&
+               point.x < rect.origin.x + rect.size.x && point.y < rect.origin.y + rect.size.y;
+    }
+
+    static NodeId hit_recursive(const System *sys, NodeId id, const float2 &point, uint32_t mask) {
+        const Node &node = sys->nodes[id.index];
+        if ((node.subtree_flags & mask) != mask) return NullNode;
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        if (!contains(node.bounds, point) && !contains(node.content_extent, point)) return NullNode;
+#else
+        if (!contains(node.bounds, point)) return NullNode;
+#endif
+
+        // Last child first, it is drawn above its siblings
+        const detail::ChildRange children = detail::active_children(sys, node);
+        for (const NodeId *it = children.end(); it != children.begin();) {
+            --it;
+            const NodeId hit = hit_recursive(sys, *it, point, mask);
+            if (!hit.is_null()) return hit;
+        }
+
+        if ((node.flags & mask) == mask && contains(node.bounds, point)) return id;
+        return NullNode;
+    }
+
+    NodeId hit_test(const System *sys, NodeId root, float2 point, uint32_t mask) {
+        if (!is_valid(sys, root)) return NullNode;
+        return hit_recursive(sys, root, point, mask);
+    }
+#endif
+
+    void invalidate_layout(System *sys, NodeId id) {
+        Node *node = get_node(sys, id);
+        if (!node) return;
+
+        node->layout_clean = false;
+        forget_measure(sys, *node);
+#if FRAMEFLOW_ENABLE_MASONRY
+        // Appending is the only change a Masonry can resume from
+        reset_masonry(sys, *node);
+#endif
+        invalidate_ancestors(sys, *node);
+    }
+
+    void detail::begin_pass(System *sys) {
+        // Zero is never a valid pass, so fresh nodes have no cached measurements
+        if (++sys->layout_pass == 0) sys->layout_pass = 1;
+    }
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+    // Node index of the root of the tree holding node
+    static uint32_t root_index(const System *sys, const Node &node) {
+        const Node *n = &node;
+        while (!n->parent.is_null()) n = &sys->nodes[n->parent.index];
+        return static_cast<uint32_t>(n - sys->nodes.data());
+    }
+
+    static bool same_rect(const Rect &a, const Rect &b) {
+        return a.origin.x == b.origin.x && a.origin.y == b.origin.y && a.size.x == b.size.x && a.size.y == b.size.y;
+    }
+
+    // Place the targets the nodes of a tree are anchored to, after the targets their own trees
+    // depend on. Dirty flags don't follow a target to its dependents, so a dependent whose
+    // target moved since the last check is invalidated here. Trees already visited are skipped,
+    // which also ends cycles.
+    static void place_anchor_targets(System *sys, uint32_t root, std::vector<uint32_t> &visited) {
+        if (std::find(visited.begin(), visited.end(), root) != visited.end()) return;
+        visited.push_back(root);
+
+        for (size_t i = 0; i < sys->anchor_links.size(); i++) {
+            const AnchorLink link = sys->anchor_links[i];
+            if (root_index(sys, sys->nodes[link.dependent.index]) != root) continue;
+
+            const Node &target = sys->nodes[link.target.index];
+            place_anchor_targets(sys, root_index(sys, target), visited);
+            ensure_placed(sys, target);
+            if (same_rect(link.seen, target.bounds)) continue;
+
+            sys->anchor_links[i].seen = target.bounds;
+            invalidate_layout(sys, link.dependent);
+        }
+    }
+#endif
+
+    Rect get_bounds(System *sys, NodeId id) {
+        Node *node = get_node(sys, id);
+        if (!node) return {};
+
+        detail::begin_pass(sys);
+#if FRAMEFLOW_ENABLE_ANCHORS
+        if (!sys->anchor_links.empty()) {
+            std::vector<uint32_t> visited;
+            place_anchor_targets(sys, root_index(sys, *node), visited);
+        }
+#endif
+        ensure_placed(sys, *node);
+        return node->bounds;
+    }
+
+    // ========== Shared subtrees ==========
+    // A subtree's layout is a function of its inputs, its assigned size and the sizes its
+    // nodes kept from the previous pass (sizes only grow). Siblings agreeing on all of
+    // those get the same rects up to a translation, so the first one is solved and the
+    // others copy it. Sizes are snapshotted before solving since solving overwrites them.
+
+    // Most repeated content has a handful of variants, past that siblings are just solved
+    constexpr size_t MaxSharedLayouts = 16;
+
+    struct SharedLayout {
+        NodeId representative;
+        uint32_t first_size; // Pre-order sizes of the subtree before it was solved
+    };
+
+    static bool same_component(const System *sys, NodeType type, uint32_t a, uint32_t b) {
+        switch (type) {
+#if FRAMEFLOW_ENABLE_BOX
+            case NodeType::Box: {
+                const BoxData &x = sys->components.boxes[a], &y = sys->components.boxes[b];
+                return x.direction == y.direction && x.align == y.align;
+            }
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
+            case NodeType::Flow: {
+                const FlowData &x = sys->components.flows[a], &y = sys->components.flows[b];
+                return x.direction == y.direction && x.align == y.align;
+            }
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
+            case NodeType::Margin: {
+                const MarginData &x = sys->components.margins[a], &y = sys->components.margins[b];
+                return x.left == y.left && x.right == y.right && x.top == y.top && x.bottom == y.bottom;
+            }
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+            case NodeType::Masonry: {
+                const MasonryData &x = sys->components.masonries[a], &y = sys->components.masonries[b];
+                return x.columns == y.columns && x.spacing == y.spacing;
+            }
+#endif
+            default:
+                (void) sys;
+                (void) a;
+                (void) b;
+                return true;
+        }
+    }
+
+    static bool same_breakpoints(const System *sys, const Node &a, const Node &b) {
+        const std::vector<Breakpoint> *table_a = breakpoints_of(sys, a);
+        const std::vector<Breakpoint> *table_b = breakpoints_of(sys, b);
+        if (!table_a || !table_b) return table_a == table_b;
+
+        const std::vector<Breakpoint> &x = *table_a;
+        const std::vector<Breakpoint> &y = *table_b;
+        if (x.size() != y.size()) return false;
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (x[i].min_width != y[i].min_width || x[i].max_width != y[i].max_width || x[i].type != y[i].type)
+                return false;
+            if (!same_component(sys, x[i].type, x[i].component_index, y[i].component_index)) return false;
+        }
+        return true;
+    }
+
+    // Whether a node can be laid out as type at some width
+    static bool may_be(const System *sys, const Node &node, NodeType type) {
+        if (node.type == type) return true;
+        const std::vector<Breakpoint> *table = breakpoints_of(sys, node);
+        if (!table) return false;
+        for (const Breakpoint &breakpoint: *table)
+            if (breakpoint.type == type) return true;
+        return false;
+    }
+
+    // Generic children placed by their anchors on both axes, the others keep the
+    // absolute origin the host gave them and can't be translated
+    static bool fully_anchored(const Node &child) {
+#if FRAMEFLOW_ENABLE_ANCHORS
+        return child.anchors.right > child.anchors.left && child.anchors.bottom > child.anchors.top;
+#else
+        (void) child;
+        return false;
+#endif
+    }
+
+    // Record the sizes of a subtree in pre-order, false if it can't be shared
+    static bool snapshot_sizes(const System *sys, const Node &node, std::vector<float2> &sizes) {
+        sizes.push_back(node.bounds.size);
+
+        // Inactive pages keep results of their own that can't be copied
+        if (may_be(sys, node, NodeType::Stack)) return false;
+
+        const bool generic = may_be(sys, node, NodeType::Generic);
+        for (NodeId child_id: node.children) {
+            const Node &child = sys->nodes[child_id.index];
+            if (generic && !fully_anchored(child)) return false;
+            if (has_anchor_target(child)) return false;
+            if (!snapshot_sizes(sys, child, sizes)) return false;
+        }
+        return true;
+    }
+
+    // Whether node would be solved exactly like the representative was, sizes are
+    // compared against the representative's snapshot starting at size
+    static bool same_subtree(const System *sys, const Node &rep, const Node &node,
+                             const float2 *&size) {
+        if (rep.type != node.type || rep.children.size() != node.children.size()) return false;
+        if (size->x != node.bounds.size.x || size->y != node.bounds.size.y) return false;
+        ++size;
+
+        if (rep.mirror_x != node.mirror_x) return false;
+        if (rep.minimum_size.x != node.minimum_size.x || rep.minimum_size.y != node.minimum_size.y) return false;
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+        if (rep.aspect_ratio != node.aspect_ratio) return false;
+        if (rep.percent_size.x != node.percent_size.x || rep.percent_size.y != node.percent_size.y) return false;
+#endif
+#if FRAMEFLOW_ENABLE_EXPAND
+        if (rep.expand.x != node.expand.x || rep.expand.y != node.expand.y) return false;
+        if (rep.stretch.x != node.stretch.x || rep.stretch.y != node.stretch.y) return false;
+#endif
+#if FRAMEFLOW_ENABLE_ANCHORS
+        if (rep.anchors.left != node.anchors.left || rep.anchors.top != node.anchors.top ||
+            rep.anchors.right != node.anchors.right || rep.anchors.bottom != node.anchors.bottom)
+            return false;
+        if (rep.offsets.left != node.offsets.left || rep.offsets.top != node.offsets.top ||
+            rep.offsets.right != node.offsets.right || rep.offsets.bottom != node.offsets.bottom)
+            return false;
+#endif
+        if (!same_component(sys, rep.type, rep.component_index, node.component_index)) return false;
+        if (!same_breakpoints(sys, rep, node)) return false;
+
+        // The representative's children are all anchored where they need to be
+        for (size_t i = 0; i < rep.children.size(); ++i) {
+            const Node &rep_child = sys->nodes[rep.children[i].index];
+            const Node &child = sys->nodes[node.children[i].index];
+            if (!same_subtree(sys, rep_child, child, size)) return false;
+        }
+        return true;
+    }
+
+    // Copy the solved rects below from into to, translated by delta
+    static void copy_subtree_layout(System *sys, const Node &from, Node &to, const float2 &delta) {
+        for (size_t i = 0; i < from.children.size(); ++i) {
+            const Node &source = sys->nodes[from.children[i].index];
+            Node &target = sys->nodes[to.children[i].index];
+            target.bounds.origin = source.bounds.origin + delta;
+            target.bounds.size = source.bounds.size;
+            copy_subtree_layout(sys, source, target, delta);
+        }
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        to.content_extent = {from.content_extent.origin + delta, from.content_extent.size};
+        to.overflow = from.overflow;
+#endif
+        to.layout_clean = true;
+        drop_box_indices(sys, to); // Copied, not solved
+    }
+
+    bool set_share_layouts(System *sys, NodeId id, bool share) {
+        Node *node = get_node(sys, id);
+        if (!node) return false;
+
+        if (node->share_children != share) ++sys->structure_version; // Tapes leave shared children to layout_subtree
+        node->share_children = share;
+        return true;
+    }
+
+    // Representatives of the shared lists being solved and their sizes. Solving a child can
+    // reach a nested shared list, which pushes its entries after the ones of its ancestors and
+    // pops them when done.
+    static thread_local std::vector<SharedLayout> shared_solved;
+    static thread_local std::vector<float2> shared_sizes;
+
+    static void layout_shared_children(System *sys, detail::ChildRange children, bool mirrored) {
+        std::vector<SharedLayout> &solved = shared_solved;
+        std::vector<float2> &sizes = shared_sizes;
+        const size_t first_entry = solved.size();
+        const size_t first_size = sizes.size();
+
+        for (const NodeId &child_id: children) {
+            Node &child = sys->nodes[child_id.index];
+            const bool child_mirrored = mirrored || child.mirror_x;
+
+            bool copied = false;
+            for (size_t e = first_entry; e < solved.size(); ++e) {
+                const SharedLayout &entry = solved[e];
+                const Node &rep = sys->nodes[entry.representative.index];
+                const float2 *size = sizes.data() + entry.first_size;
+                if (!same_subtree(sys, rep, child, size)) continue;
+
+                copy_subtree_layout(sys, rep, child, child.bounds.origin - rep.bounds.origin);
+                copied = true;
+                break;
+            }
+            if (copied) continue;
+
+            // Becomes a representative if it can be shared and there's room
+            const size_t child_sizes = sizes.size();
+            const bool shareable = solved.size() - first_entry < MaxSharedLayouts && snapshot_sizes(sys, child, sizes);
+            if (shareable) solved.push_back({child_id, static_cast<uint32_t>(child_sizes)});
+            else sizes.resize(child_sizes);
+
+            detail::layout_subtree(sys, child, child_mirrored);
+        }
+
+        solved.resize(first_entry);
+        sizes.resize(first_size);
+    }
+
+    // ========== Stack pages ==========
+    // A page is skipped when its inputs and bounds are the ones it had right after it was last
+    // solved: solving is idempotent, so it would produce the same rects again. Inactive pages
+    // aren't visited at all and keep their last results.
+
+    static uint64_t page_mix(uint64_t h, uint64_t word) {
+        h ^= word;
+        h *= 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 32);
+    }
+
+    static uint64_t page_mix(uint64_t h, const float2 &v) {
+        uint64_t word;
+        std::memcpy(&word, &v, sizeof word);
+        return page_mix(h, word);
+    }
+
+    static uint64_t page_mix(uint64_t h, const Rect &r) {
+        return page_mix(page_mix(h, r.origin), r.size);
+    }
+
+    static uint64_t page_mix_component(const System *sys, uint64_t h, NodeType type, uint32_t comp_idx) {
+        h = page_mix(h, static_cast<uint64_t>(type));
+        switch (type) {
+#if FRAMEFLOW_ENABLE_BOX
+            case NodeType::Box: {
+                const BoxData &box = sys->components.boxes[comp_idx];
+                return page_mix(h, static_cast<uint64_t>(box.direction) << 32 | static_cast<uint64_t>(box.align));
+            }
+#endif
+#if FRAMEFLOW_ENABLE_FLOW
+            case NodeType::Flow: {
+                const FlowData &flow = sys->components.flows[comp_idx];
+                return page_mix(h, static_cast<uint64_t>(flow.direction) << 32 | static_cast<uint64_t>(flow.align));
+            }
+#endif
+#if FRAMEFLOW_ENABLE_MARGIN
+            case NodeType::Margin: {
+                const MarginData &margin = sys->components.margins[comp_idx];
+                return page_mix(page_mix(h, float2{margin.left, margin.right}), float2{margin.top, margin.bottom});
+            }
+#endif
+#if FRAMEFLOW_ENABLE_STACK
+            case NodeType::Stack:
+                return page_mix(h, static_cast<uint64_t>(sys->components.stacks[comp_idx].active));
+#endif
+#if FRAMEFLOW_ENABLE_MASONRY
+            case NodeType::Masonry: {
+                const MasonryData &masonry = sys->components.masonries[comp_idx];
+                return page_mix(page_mix(h, static_cast<uint64_t>(masonry.columns)), float2{masonry.spacing, 0.f});
+            }
+#endif
+            default:
+                (void) sys;
+                (void) comp_idx;
+                return h;
+        }
+    }
+
+    static uint64_t hash_page(const System *sys, const Node &node, uint64_t h) {
+        h = page_mix(h, node.bounds);
+        h = page_mix(h, node.minimum_size);
+#if FRAMEFLOW_ENABLE_RELATIVE_SIZE
+        h = page_mix(h, node.percent_size);
+        h = page_mix(h, float2{node.aspect_ratio, node.mirror_x ? 1.f : 0.f});
+#else
+        h = page_mix(h, float2{0.f, node.mirror_x ? 1.f : 0.f});
+#endif
+#if FRAMEFLOW_ENABLE_EXPAND
+        h = page_mix(page_mix(h, node.expand), node.stretch);
+#endif
+#if FRAMEFLOW_ENABLE_ANCHORS
+        h = page_mix(h, Rect{{node.anchors.left, node.anchors.top}, {node.anchors.right, node.anchors.bottom}});
+        h = page_mix(h, Rect{{node.offsets.left, node.offsets.top}, {node.offsets.right, node.offsets.bottom}});
+        if (const Node *target = anchor_target(sys, node)) h = page_mix(h, target->bounds);
+#endif
+        h = page_mix_component(sys, h, node.type, node.component_index);
+        if (const std::vector<Breakpoint> *table = breakpoints_of(sys, node)) {
+            for (const Breakpoint &breakpoint: *table) {
+                h = page_mix(h, float2{breakpoint.min_width, breakpoint.max_width});
+                h = page_mix_component(sys, h, breakpoint.type, breakpoint.component_index);
+            }
+        }
+
+        // Structure, then only what solving this node reaches
+        for (NodeId child_id: node.children)
+            h = page_mix(h, static_cast<uint64_t>(child_id.generation) << 32 | child_id.index);
+        for (NodeId child_id: detail::active_children(sys, node))
+            h = hash_page(sys, sys->nodes[child_id.index], h);
+        return h;
+    }
+
+    uint64_t detail::hash_subtree(const System *sys, const Node &node, bool mirrored) {
+        const uint64_t seed = mirrored ? 0x6A09E667F3BCC908ull : 0xBB67AE8584CAA73Bull;
+        return hash_page(sys, node, seed);
+    }
+
+    void detail::drop_solve_state(System *sys, Node &node) {
+#if FRAMEFLOW_ENABLE_MASONRY
+        reset_masonry(sys, node);
+#endif
+        drop_box_indices(sys, node);
+#if FRAMEFLOW_ENABLE_STACK
+        // The hash the node has as a page, if its parent is a Stack
+        const Node *parent = get_node(sys, node.parent);
+        if (!parent || parent->type != NodeType::Stack) return;
+        const auto index = static_cast<uint32_t>(&node - sys->nodes.data());
+        for (PageHash &entry: sys->components.stack_states[parent->component_index].pages)
+            if (entry.page.index == index) entry.hash = 0;
+#endif
+    }
+
+#if FRAMEFLOW_ENABLE_STACK
+    // Solve the page at position of a Stack, unless its stored hash still matches
+    static void layout_page(System *sys, uint32_t stack, size_t position, NodeId page_id, bool mirrored) {
+        Node &page = sys->nodes[page_id.index];
+        std::vector<PageHash> &pages = sys->components.stack_states[stack].pages;
+        if (pages.size() <= position) pages.resize(position + 1);
+        const PageHash stored = pages[position];
+        if (stored.page == page_id && stored.hash != 0 && detail::hash_subtree(sys, page, mirrored) == stored.hash) {
+            page.layout_clean = true;
+            return;
+        }
+
+        detail::layout_subtree(sys, page, mirrored);
+        sys->components.stack_states[stack].pages[position] = {page_id, detail::hash_subtree(sys, page, mirrored)};
+    }
+#endif
+
+    void detail::include_child_extents(System *sys, Node &node) {
+#if !FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        (void) sys;
+        (void) node;
+#else
+        Rect extent = node.content_extent;
+        bool grown = false;
+        for (NodeId child_id: detail::active_children(sys, node)) {
+            const Node &child = sys->nodes[child_id.index];
+            if (child.children.empty()) continue;
+            extent = detail::rect_union(extent, child.content_extent);
+            grown = true;
+        }
+        if (grown) detail::set_content_extent(node, extent);
+#endif
+    }
+
+    void detail::layout_subtree(System *sys, Node &node, bool mirrored) {
+        const Breakpoint variant = detail::active_variant(sys, node);
+        const detail::ChildRange children = detail::solve_as(sys, node, variant, mirrored);
+
+        if (node.share_children && sys->fast_paths) {
+            layout_shared_children(sys, children, mirrored);
+            detail::include_child_extents(sys, node);
+            return;
+        }
+
+        // Extents of the children grow the node's as they are solved, see include_child_extents
+#if FRAMEFLOW_ENABLE_STACK
+        const bool pages = sys->fast_paths && variant.type == NodeType::Stack;
+#endif
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        Rect extent = node.content_extent;
+        bool grown = false;
+#endif
+        for (const NodeId &child_id: children) {
+            Node &child = sys->nodes[child_id.index];
+            const bool child_mirrored = mirrored || child.mirror_x;
+#if FRAMEFLOW_ENABLE_STACK
+            const auto position = static_cast<size_t>(&child_id - node.children.data());
+            if (pages) layout_page(sys, variant.component_index, position, child_id, child_mirrored);
+            else detail::layout_subtree(sys, child, child_mirrored);
+#else
+            detail::layout_subtree(sys, child, child_mirrored);
+#endif
+
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            if (child.children.empty()) continue;
+            extent = detail::rect_union(extent, child.content_extent);
+            grown = true;
+#endif
+        }
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        if (grown) detail::set_content_extent(node, extent);
+#endif
+    }
+
+    void compute_layout(System *sys, const NodeId node_id) {
+        Node *node = get_node(sys, node_id);
+        if (!node) return;
+
+        detail::begin_pass(sys);
+        detail::layout_subtree(sys, *node, detail::is_mirrored(sys, *node));
+    }
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+    bool set_anchor_target(System *sys, NodeId id, NodeId target) {
+        Node *node = get_node(sys, id);
+        if (!node) return false;
+        if (!target.is_null() && (!is_valid(sys, target) || target == id)) return false;
+
+        std::vector<AnchorLink> &links = sys->anchor_links;
+        if (!node->anchor_target.is_null()) {
+            const auto it = std::find_if(links.begin(), links.end(),
+                                         [id](const AnchorLink &link) { return link.dependent == id; });
+            *it = links.back();
+            links.pop_back();
+        }
+        if (!target.is_null()) links.push_back({target, id, {}});
+
+        node->anchor_target = target;
+        invalidate_layout(sys, id);
+        return true;
+    }
+#endif
+
+    // Number the root of every node in a subtree
+    static void assign_root(const System *sys, const Node &node, uint32_t root, std::vector<uint32_t> &root_of) {
+        for (NodeId child_id: node.children) {
+            root_of[child_id.index] = root;
+            assign_root(sys, sys->nodes[child_id.index], root, root_of);
+        }
+    }
+
+    bool compute_layout_all(System *sys) {
+        std::vector<uint32_t> roots; // Node index of every root
+        std::vector<uint32_t> root_of(sys->nodes.size(), UINT32_MAX);
+        for (uint32_t i = 0; i < sys->nodes.size(); ++i) {
+            const Node &node = sys->nodes[i];
+            if (!node.alive || !node.parent.is_null()) continue;
+
+            root_of[i] = static_cast<uint32_t>(roots.size());
+            assign_root(sys, node, root_of[i], root_of);
+            roots.push_back(i);
+        }
+
+        // Edges from the root holding a target to the roots anchored to it
+        std::vector<std::vector<uint32_t> > dependents(roots.size());
+        std::vector<uint32_t> pending(roots.size(), 0);
+#if FRAMEFLOW_ENABLE_ANCHORS
+        for (const AnchorLink &link: sys->anchor_links) {
+            const uint32_t from = root_of[link.target.index];
+            const uint32_t to = root_of[link.dependent.index];
+            if (from == to) continue;
+            dependents[from].push_back(to);
+            ++pending[to];
+        }
+#endif
+
+        // Kahn's algorithm, roots are laid out as soon as nothing they depend on is pending
+        std::vector<uint32_t> ready;
+        for (uint32_t r = 0; r < roots.size(); ++r)
+            if (pending[r] == 0) ready.push_back(r);
+
+        detail::begin_pass(sys);
+        size_t laid_out = 0;
+        while (!ready.empty()) {
+            const uint32_t r = ready.back();
+            ready.pop_back();
+
+            Node &root = sys->nodes[roots[r]];
+            detail::layout_subtree(sys, root, root.mirror_x);
+            ++laid_out;
+
+            for (uint32_t dependent: dependents[r])
+                if (--pending[dependent] == 0) ready.push_back(dependent);
+        }
+        if (laid_out != roots.size()) return false;
+
+#if FRAMEFLOW_ENABLE_ANCHORS
+        // Every dependent was placed from its target's final bounds, see get_bounds
+        for (AnchorLink &link: sys->anchor_links) link.seen = sys->nodes[link.target.index].bounds;
+#endif
+        return true;
     }
 } // namespace frameflow
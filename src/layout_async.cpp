@@ -0,0 +1,36 @@
+#include "frameflow/layout_async.hpp"
+#include "layout_internal.hpp"
+
+#include <memory>
+#include <thread>
+
+namespace frameflow {
+    static void run(const Executor &executor, std::function<void()> task) {
+        if (executor) {
+            executor(std::move(task));
+        } else {
+            std::thread(std::move(task)).detach();
+        }
+    }
+
+    void destroy_system_async(System &&sys, const Executor &executor) {
+        auto doomed = std::make_shared<System>(std::move(sys));
+        sys = System{};
+
+        // Move out inside the task so the memory is freed on the executor's thread,
+        // no matter which copy of the task is destroyed last
+        run(executor, [doomed]() {
+            System local = std::move(*doomed);
+        });
+    }
+
+    bool release_subtree_async(System *sys, NodeId id, const Executor &executor) {
+        auto garbage = std::make_shared<detail::ChildListGarbage>();
+        if (!detail::delete_subtree(sys, id, garbage.get())) return false;
+
+        run(executor, [garbage]() {
+            detail::ChildListGarbage local = std::move(*garbage);
+        });
+        return true;
+    }
+} // namespace frameflow
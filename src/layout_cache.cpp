@@ -0,0 +1,184 @@
+#include "frameflow/layout_cache.hpp"
+#include "layout_internal.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace frameflow {
+    // File header, the version changes with the format or with what the key hashes
+    static constexpr char CacheMagic[4] = {'F', 'F', 'L', 'C'};
+    // Builds without content extents don't store them, their files have the high bit set.
+    static constexpr uint32_t CacheVersion = FRAMEFLOW_ENABLE_CONTENT_EXTENT ? 1u : 1u | 0x80000000u;
+
+    // Visit the nodes of a subtree in the order compute_layout solves them
+    template<typename Visit>
+    static void visit_solved(System *sys, Node &node, Visit &visit) {
+        visit(node);
+        for (NodeId child_id: detail::active_children(sys, node)) visit_solved(sys, sys->nodes[child_id.index], visit);
+    }
+
+    uint64_t layout_cache_key(const System *sys, NodeId root) {
+        const Node *node = get_node(sys, root);
+        if (!node) return 0;
+        return detail::hash_subtree(sys, *node, detail::is_mirrored(sys, *node));
+    }
+
+    static const CachedLayout *find_entry(const LayoutCache *cache, uint64_t key) {
+        for (const CachedLayout &entry: cache->entries) {
+            if (entry.key == key) return &entry;
+        }
+        return nullptr;
+    }
+
+    // Whether the entry has one result per node from i on in the subtree, walking the children
+    // each node would lay out at its cached width. Advances i past the subtree.
+    static bool entry_covers(const System *sys, const Node &node, const CachedLayout &entry, size_t &i) {
+        if (i >= entry.bounds.size()) return false;
+        const float width = entry.bounds[i++].size.x;
+        for (NodeId child_id: detail::children_at(sys, node, width)) {
+            if (!entry_covers(sys, sys->nodes[child_id.index], entry, i)) return false;
+        }
+        return true;
+    }
+
+    // Fill the subtree from an entry. Breakpoints pick children by width, so the entry is first
+    // checked against the subtree with the widths it holds, and nothing is written unless it has
+    // exactly one result per node. A mismatch takes a hash collision or a corrupt entry.
+    static bool apply_entry(System *sys, Node &root, const CachedLayout &entry) {
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        if (entry.content_extents.size() != entry.bounds.size() || entry.overflow.size() != entry.bounds.size())
+            return false;
+#endif
+        size_t count = 0;
+        if (!entry_covers(sys, root, entry, count) || count != entry.bounds.size()) return false;
+
+        size_t i = 0;
+        auto fill_node = [&](Node &node) {
+            node.bounds = entry.bounds[i];
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            node.content_extent = entry.content_extents[i];
+            node.overflow = entry.overflow[i] != 0;
+#endif
+            node.layout_clean = true;
+            detail::drop_solve_state(sys, node);
+            i++;
+        };
+        visit_solved(sys, root, fill_node);
+        return true;
+    }
+
+    static void add_entry(System *sys, Node &root, uint64_t key, LayoutCache *cache) {
+        auto &entries = cache->entries;
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [key](const CachedLayout &entry) { return entry.key == key; }),
+                      entries.end());
+        if (cache->capacity == 0) return;
+        if (entries.size() >= cache->capacity)
+            entries.erase(entries.begin(), entries.begin() + (entries.size() - cache->capacity + 1));
+
+        CachedLayout entry;
+        entry.key = key;
+        auto record_node = [&entry](Node &node) {
+            entry.bounds.push_back(node.bounds);
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            entry.content_extents.push_back(node.content_extent);
+            entry.overflow.push_back(node.overflow ? 1 : 0);
+#endif
+        };
+        visit_solved(sys, root, record_node);
+        entries.push_back(std::move(entry));
+        cache->modified = true;
+    }
+
+    bool compute_layout_cached(System *sys, NodeId root, LayoutCache *cache) {
+        Node *node = get_node(sys, root);
+        if (!node) return false;
+
+        const uint64_t key = layout_cache_key(sys, root);
+        if (const CachedLayout *entry = find_entry(cache, key)) {
+            if (apply_entry(sys, *node, *entry)) return true;
+        }
+
+        // A mismatched entry is replaced
+        compute_layout(sys, root);
+        add_entry(sys, *node, key, cache);
+        return false;
+    }
+
+    template<typename T>
+    static bool write_values(std::FILE *file, const T *values, size_t count) {
+        return std::fwrite(values, sizeof(T), count, file) == count;
+    }
+
+    template<typename T>
+    static bool read_values(std::FILE *file, T *values, size_t count) {
+        return std::fread(values, sizeof(T), count, file) == count;
+    }
+
+    bool save_layout_cache(LayoutCache *cache, const char *path) {
+        std::FILE *file = std::fopen(path, "wb");
+        if (!file) return false;
+
+        const auto entry_count = static_cast<uint32_t>(cache->entries.size());
+        bool ok = write_values(file, CacheMagic, 4) && write_values(file, &CacheVersion, 1) &&
+                  write_values(file, &entry_count, 1);
+        for (const CachedLayout &entry: cache->entries) {
+            const auto node_count = static_cast<uint32_t>(entry.bounds.size());
+            ok = ok && write_values(file, &entry.key, 1) && write_values(file, &node_count, 1) &&
+                 write_values(file, entry.bounds.data(), node_count);
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            ok = ok && write_values(file, entry.content_extents.data(), node_count) &&
+                 write_values(file, entry.overflow.data(), node_count);
+#endif
+        }
+
+        ok = std::fclose(file) == 0 && ok;
+        if (ok) cache->modified = false;
+        return ok;
+    }
+
+    static bool read_entries(std::FILE *file, LayoutCache *cache) {
+        char magic[4];
+        uint32_t version = 0;
+        uint32_t entry_count = 0;
+        if (!read_values(file, magic, 4) || !read_values(file, &version, 1) || !read_values(file, &entry_count, 1))
+            return false;
+        if (std::memcmp(magic, CacheMagic, 4) != 0 || version != CacheVersion) return false;
+
+        for (uint32_t e = 0; e < entry_count; e++) {
+            CachedLayout entry;
+            uint32_t node_count = 0;
+            if (!read_values(file, &entry.key, 1) || !read_values(file, &node_count, 1)) return false;
+
+            // Grown as values arrive, so a corrupt count fails at the end of the file
+            for (uint32_t i = 0; i < node_count; i++) {
+                Rect bounds;
+                if (!read_values(file, &bounds, 1)) return false;
+                entry.bounds.push_back(bounds);
+            }
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            entry.content_extents.resize(node_count);
+            entry.overflow.resize(node_count);
+            if (!read_values(file, entry.content_extents.data(), node_count) ||
+                !read_values(file, entry.overflow.data(), node_count))
+                return false;
+#endif
+            cache->entries.push_back(std::move(entry));
+        }
+        return true;
+    }
+
+    bool load_layout_cache(LayoutCache *cache, const char *path) {
+        cache->entries.clear();
+        cache->modified = false;
+
+        std::FILE *file = std::fopen(path, "rb");
+        if (!file) return false;
+        const bool ok = read_entries(file, cache);
+        std::fclose(file);
+
+        if (!ok) cache->entries.clear();
+        return ok;
+    }
+} // namespace frameflow
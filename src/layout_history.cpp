@@ -0,0 +1,76 @@
+#include "frameflow/layout_history.hpp"
+
+#include <cstring>
+
+namespace frameflow {
+    static_assert(sizeof(Rect) == 4 * sizeof(uint32_t), "RectDelta holds the bits of one Rect");
+
+    static void apply_delta(Rect &rect, const RectDelta &delta) {
+        uint32_t bits[4];
+        std::memcpy(bits, &rect, sizeof bits);
+        for (int i = 0; i < 4; ++i) bits[i] ^= delta.bits[i];
+        std::memcpy(&rect, bits, sizeof bits);
+    }
+
+    void init_recorder(LayoutRecorder *recorder, uint32_t capacity) {
+        recorder->frames.assign(capacity > 0 ? capacity : 1, {});
+        recorder->newest = 0;
+        recorder->count = 0;
+        recorder->next_number = 0;
+        recorder->current.clear();
+    }
+
+    uint64_t record_frame(LayoutRecorder *recorder, const System *sys) {
+        if (recorder->frames.empty()) return NoFrame;
+
+        const auto capacity = static_cast<uint32_t>(recorder->frames.size());
+        recorder->newest = recorder->count == 0 ? 0 : (recorder->newest + 1) % capacity;
+        if (recorder->count < capacity) ++recorder->count;
+
+        RecordedFrame &frame = recorder->frames[recorder->newest];
+        frame.number = recorder->next_number++;
+        frame.node_count = static_cast<uint32_t>(sys->nodes.size());
+        frame.changes.clear();
+
+        // Nodes created since the last frame start from an empty rect
+        if (recorder->current.size() < sys->nodes.size()) recorder->current.resize(sys->nodes.size(), Rect{});
+
+        const Node *nodes = sys->nodes.data();
+        Rect *current = recorder->current.data();
+        for (uint32_t i = 0; i < frame.node_count; ++i) {
+            Rect &previous = current[i];
+            const Rect &bounds = nodes[i].bounds;
+
+            // Most rects don't change, compare their four 32-bit words without branching per field
+            uint32_t old_bits[4], new_bits[4];
+            std::memcpy(old_bits, &previous, sizeof old_bits);
+            std::memcpy(new_bits, &bounds, sizeof new_bits);
+            RectDelta delta{i, {old_bits[0] ^ new_bits[0], old_bits[1] ^ new_bits[1],
+                                old_bits[2] ^ new_bits[2], old_bits[3] ^ new_bits[3]}};
+            if ((delta.bits[0] | delta.bits[1] | delta.bits[2] | delta.bits[3]) == 0) continue;
+
+            frame.changes.push_back(delta);
+            previous = bounds;
+        }
+        return frame.number;
+    }
+
+    bool reconstruct_frame(const LayoutRecorder *recorder, uint64_t frame, std::vector<Rect> *bounds) {
+        if (recorder->count == 0 || recorder->frames.empty()) return false;
+
+        const auto capacity = static_cast<uint32_t>(recorder->frames.size());
+        const uint64_t newest = recorder->frames[recorder->newest].number;
+        if (frame > newest || newest - frame >= recorder->count) return false;
+
+        // Walk back from the newest frame, undoing each frame after the requested one
+        *bounds = recorder->current;
+        uint32_t slot = recorder->newest;
+        for (uint64_t n = newest; n > frame; --n) {
+            for (const RectDelta &delta: recorder->frames[slot].changes) apply_delta((*bounds)[delta.node], delta);
+            slot = (slot + capacity - 1) % capacity;
+        }
+
+        bounds->resize(recorder->frames[slot].node_count);
+        return true;
+    }
+} // namespace frameflow
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "frameflow/layout.hpp"
+#include "frameflow/layout_simd.hpp"
+
+// Solver entry points shared by the optional modules, not part of the public API
+namespace frameflow::detail {
+    // Place the direct children of a node from its current bounds, right-to-left if mirrored.
+    // Children are marked dirty and the node clean, see invalidate_layout.
+    void solve_node(System *sys, Node &node, bool mirrored);
+
+    struct ChildRange {
+        const NodeId *first = nullptr;
+        const NodeId *last = nullptr;
+
+        [[nodiscard]] const NodeId *begin() const { return first; }
+        [[nodiscard]] const NodeId *end() const { return last; }
+    };
+
+    // Type and component a node is laid out with at its current width
+    Breakpoint active_variant(const System *sys, const Node &node);
+
+    // Place the direct children of a node laid out as variant and mark the node clean, returns
+    // the ones it placed. Unlike solve_node the children aren't marked, the caller solves them.
+    ChildRange solve_as(System *sys, Node &node, const Breakpoint &variant, bool mirrored);
+
+    // solve_as for a Generic node without children or breakpoints
+    void solve_leaf(Node &node);
+
+    // Children the node lays out at its current width, only the active page of a Stack
+    ChildRange active_children(const System *sys, const Node &node);
+
+    // Children the node would lay out at width, before its bounds are set
+    ChildRange children_at(const System *sys, const Node &node, float width);
+
+    // Solve the node and everything below it, taking the fast paths (shared children,
+    // Stack pages) when System::fast_paths is on
+    void layout_subtree(System *sys, Node &node, bool mirrored);
+
+    // Smallest rect covering both
+    Rect rect_union(const Rect &a, const Rect &b);
+
+    // Store a content extent and whether it leaves the node's bounds, unchanged values aren't
+    // written again
+    void set_content_extent(Node &node, const Rect &extent);
+
+    // Grow the content extent solve_node gave a node by the extents of its children, once
+    // they are solved, so that it covers the whole subtree
+    void include_child_extents(System *sys, Node &node);
+
+    // Whether the node or one of its ancestors is laid out right-to-left
+    bool is_mirrored(const System *sys, const Node &node);
+
+    // Start a layout pass, cached height-for-width measurements expire
+    void begin_pass(System *sys);
+
+    // anchor_kernel, anchored_x receives whether each rect was placed horizontally if not null
+    void anchor_rects(const AnchorSpans &in, bool mirrored, Rect *rects, uint8_t *anchored_x);
+
+    // Applies anchored edges on each axis where they span a nonzero extent,
+    // returns true if the horizontal one was
+    inline bool apply_anchor_edges(Rect &rect, float left, float top, float right, float bottom) {
+        if (right > left) rect.origin.x = left, rect.size.x = right - left;
+        if (bottom > top) rect.origin.y = top, rect.size.y = bottom - top;
+        return right > left;
+    }
+
+    // Hash of the bounds and inputs of the subtree that solving node reaches (active pages,
+    // anchor targets' bounds). Depends only on the tree, so it's stable between runs.
+    uint64_t hash_subtree(const System *sys, const Node &node, bool mirrored);
+
+    // Forget what the node kept from its last solve (Masonry placement, Box index, page hash)
+    // after its children were placed some other way
+    void drop_solve_state(System *sys, Node &node);
+
+    using ChildListGarbage = std::vector<std::vector<NodeId> >;
+
+    // delete_node, optionally moving the children storage of every deleted node
+    // into garbage so the caller decides where it is freed
+    bool delete_subtree(System *sys, NodeId id, ChildListGarbage *garbage);
+} // namespace frameflow::detail
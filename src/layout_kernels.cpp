@@ -0,0 +1,201 @@
+#include "frameflow/layout_kernels.hpp"
+#include "layout_internal.hpp"
+#include "simd/kernels_impl.hpp"
+
+#include <algorithm>
+
+namespace frameflow {
+    // Per-item arrays box_kernel splits its inputs into, grown as needed and reused between calls
+    struct KernelScratch {
+        std::vector<float> main_sizes;
+        std::vector<float> weights;
+        std::vector<float> offsets;
+        std::vector<float> distributed;
+    };
+
+    static thread_local KernelScratch box_scratch;
+
+    static float2 expand_at(const ItemSpans &items, size_t i) {
+        return items.expand ? items.expand[i] : float2{0.f, 0.f};
+    }
+
+    // Rects of the items of a Box in order, before mirroring. The main axis is distributed on
+    // item sizes and stretch weights, 0 for items that don't expand.
+    template<typename Place>
+    static void place_box_items(const ItemSpans &items, const Rect &frame, const BoxData &data, Place &&place) {
+        const bool horizontal = data.direction == Direction::Horizontal;
+        const size_t count = items.count;
+        KernelScratch &scratch = box_scratch;
+        if (scratch.main_sizes.size() < count) {
+            scratch.main_sizes.resize(count);
+            scratch.weights.resize(count);
+            scratch.offsets.resize(count);
+            scratch.distributed.resize(count);
+        }
+        float *main_sizes = scratch.main_sizes.data();
+        float *weights = scratch.weights.data();
+
+        float total_main = 0.f;
+        float total_stretch = 0.f;
+        for (size_t i = 0; i < count; i++) {
+            const float expand = horizontal ? expand_at(items, i).x : expand_at(items, i).y;
+            const float2 stretch = items.stretch ? items.stretch[i] : float2{1.f, 1.f};
+            main_sizes[i] = horizontal ? items.sizes[i].x : items.sizes[i].y;
+            weights[i] = expand > 0.f ? (horizontal ? stretch.x : stretch.y) : 0.f;
+            total_main += main_sizes[i];
+            total_stretch += weights[i];
+        }
+
+        const float leftover = std::max(0.f, (horizontal ? frame.size.x : frame.size.y) - total_main);
+
+        // Determine starting cursor based on alignment
+        float cursor = horizontal ? frame.origin.x : frame.origin.y;
+        float spacing = 0.f;
+        switch (data.align) {
+            case Align::Start: break;
+            case Align::Center: cursor += leftover * 0.5f;
+                break;
+            case Align::End: cursor += leftover;
+                break;
+            case Align::SpaceBetween:
+                if (count > 1) spacing = leftover / (count - 1);
+                break;
+        }
+
+        const float *offsets = scratch.offsets.data();
+        const float *sizes = scratch.distributed.data();
+        distribute_spans(main_sizes, weights, count, leftover, total_stretch, cursor, spacing,
+                         scratch.offsets.data(), scratch.distributed.data());
+        for (size_t i = 0; i < count; i++) {
+            const float2 size = items.sizes[i];
+            place(i, horizontal
+                         ? Rect{{offsets[i], frame.origin.y}, {sizes[i], size.y}}
+                         : Rect{{frame.origin.x, offsets[i]}, {size.x, sizes[i]}});
+        }
+    }
+
+    void box_kernel(const ItemSpans &items, const Rect &frame, const BoxData &data, bool mirrored, Rect *out) {
+        if (items.count == 0) return;
+        place_box_items(items, frame, data, [out](size_t i, const Rect &rect) { out[i] = rect; });
+
+        // Right-to-left starts from the opposite edge
+        if (mirrored) mirror_rects(out, items.count, frame.origin.x, frame.size.x);
+    }
+
+    void box_kernel(const ItemSpans &items, const Rect &frame, const BoxData &data, bool mirrored,
+                    const PlaceItem &place) {
+        if (items.count == 0) return;
+        place_box_items(items, frame, data, [&](size_t i, Rect rect) {
+            // The same reflection as mirror_rects, one rect at a time
+            if (mirrored) detail::mirror_rect(&rect.origin.x, frame.origin.x, frame.size.x);
+            place(i, rect);
+        });
+    }
+
+    void flow_kernel(const ItemSpans &items, const Rect &frame, const FlowData &data, bool mirrored, Rect *out) {
+        float2 offset = frame.origin;
+        float cross_line = 0.f;
+
+        for (size_t i = 0; i < items.count; i++) {
+            // Expand on cross axis only
+            float2 size = items.sizes[i];
+            if (data.direction == Direction::Horizontal && expand_at(items, i).y > 0.f) size.y = frame.size.y;
+            if (data.direction == Direction::Vertical && expand_at(items, i).x > 0.f) size.x = frame.size.x;
+
+            // Wrap if necessary
+            if (data.direction == Direction::Horizontal) {
+                float parent_right = frame.origin.x + frame.size.x;
+                if (offset.x + size.x > parent_right) {
+                    offset.x = frame.origin.x;
+                    offset.y += cross_line;
+                    cross_line = 0.f;
+                }
+                out[i] = {offset, size};
+                offset.x += size.x;
+                cross_line = std::max(cross_line, size.y);
+            } else {
+                float parent_bottom = frame.origin.y + frame.size.y;
+                if (offset.y + size.y > parent_bottom) {
+                    offset.y = frame.origin.y;
+                    offset.x += cross_line;
+                    cross_line = 0.f;
+                }
+                out[i] = {offset, size};
+                offset.y += size.y;
+                cross_line = std::max(cross_line, size.x);
+            }
+        }
+
+        // Right-to-left fills lines (or columns) from the opposite edge
+        if (mirrored) mirror_rects(out, items.count, frame.origin.x, frame.size.x);
+    }
+
+    Rect margin_inner_rect(const Rect &frame, const MarginData &data, bool mirrored) {
+        return {
+            {frame.origin.x + (mirrored ? data.right : data.left), frame.origin.y + data.top},
+            {
+                std::max(0.f, frame.size.x - data.left - data.right),
+                std::max(0.f, frame.size.y - data.top - data.bottom)
+            }
+        };
+    }
+
+    void margin_kernel(const ItemSpans &items, const Rect &frame, const MarginData &data, bool mirrored, Rect *out) {
+        const Rect inner = margin_inner_rect(frame, data, mirrored);
+        for (size_t i = 0; i < items.count; i++) {
+            float2 size = items.sizes[i];
+            if (expand_at(items, i).x > 0.f) size.x = std::max(size.x, inner.size.x);
+            if (expand_at(items, i).y > 0.f) size.y = std::max(size.y, inner.size.y);
+            out[i] = {inner.origin, size};
+        }
+
+        // Right-to-left starts at the inner right edge
+        if (mirrored) mirror_rects(out, items.count, inner.origin.x, inner.size.x);
+    }
+
+    void center_kernel(const ItemSpans &items, const Rect &frame, Rect *out) {
+        for (size_t i = 0; i < items.count; i++) {
+            float2 size = items.sizes[i];
+            if (expand_at(items, i).x > 0.f) size.x = frame.size.x;
+            if (expand_at(items, i).y > 0.f) size.y = frame.size.y;
+
+            float2 offset{
+                (frame.size.x - size.x) * 0.5f,
+                (frame.size.y - size.y) * 0.5f
+            };
+            out[i] = {frame.origin + offset, size};
+        }
+    }
+
+    void detail::anchor_rects(const AnchorSpans &in, bool mirrored, Rect *rects, uint8_t *anchored_x) {
+        // Edges are computed a block at a time so they fit on the stack
+        constexpr size_t Block = 64;
+        float edges[4][Block];
+        for (size_t first = 0; first < in.count; first += Block) {
+            AnchorSpans block = in;
+            block.count = std::min(Block, in.count - first);
+            const float **fields[12] = {
+                &block.anchor_left, &block.anchor_top, &block.anchor_right, &block.anchor_bottom,
+                &block.offset_left, &block.offset_top, &block.offset_right, &block.offset_bottom,
+                &block.frame_x, &block.frame_y, &block.frame_width, &block.frame_height
+            };
+            for (const float **field: fields) *field += first;
+
+            // Runs narrower than a vector would only take the scalar tail of any variant
+            const EdgeSpans out{edges[0], edges[1], edges[2], edges[3]};
+            if (block.count < 4) detail::resolve_anchors_impl<detail::ScalarLane>(block, mirrored, out);
+            else resolve_anchor_spans(block, mirrored, out);
+
+            // Only override bounds if anchors define a nonzero area
+            for (size_t i = 0; i < block.count; i++) {
+                const bool placed = apply_anchor_edges(rects[first + i], edges[0][i], edges[1][i], edges[2][i],
+                                                       edges[3][i]);
+                if (anchored_x) anchored_x[first + i] = placed;
+            }
+        }
+    }
+
+    void anchor_kernel(const AnchorSpans &in, bool mirrored, Rect *rects) {
+        detail::anchor_rects(in, mirrored, rects, nullptr);
+    }
+} // namespace frameflow
@@ -0,0 +1,94 @@
+#include "frameflow/layout_shadow.hpp"
+
+#include <cmath>
+#include <utility>
+
+namespace frameflow {
+    // xorshift64*, plenty for sampling
+    static float next_sample(uint64_t &state) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<float>((state * 0x2545F4914F6CDD1Dull) >> 40) * (1.f / 16777216.f);
+    }
+
+    static bool same_rect(const Rect &a, const Rect &b, float tolerance) {
+        return std::abs(a.origin.x - b.origin.x) <= tolerance && std::abs(a.origin.y - b.origin.y) <= tolerance &&
+               std::abs(a.size.x - b.size.x) <= tolerance && std::abs(a.size.y - b.size.y) <= tolerance;
+    }
+
+    // Report the topmost node of every branch whose bounds mismatch, or whose extent does
+    // without a descendant explaining it
+    static void compare_subtree(const System *sys, const System &reference, NodeId id, ShadowValidator *validator) {
+        const Node &node = sys->nodes[id.index];
+        const Node &expected = reference.nodes[id.index];
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        const ShadowMismatch mismatch{id, node.bounds, expected.bounds, node.content_extent, expected.content_extent};
+#else
+        const ShadowMismatch mismatch{id, node.bounds, expected.bounds};
+#endif
+        if (!same_rect(node.bounds, expected.bounds, validator->tolerance)) {
+            ++validator->mismatches;
+            if (validator->on_mismatch) validator->on_mismatch(mismatch);
+            return;
+        }
+
+        const uint64_t below = validator->mismatches;
+        for (NodeId child_id: node.children) compare_subtree(sys, reference, child_id, validator);
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        if (validator->mismatches != below) return;
+
+        if (!same_rect(node.content_extent, expected.content_extent, validator->tolerance) ||
+            node.overflow != expected.overflow) {
+            ++validator->mismatches;
+            if (validator->on_mismatch) validator->on_mismatch(mismatch);
+        }
+#else
+        (void) below;
+#endif
+    }
+
+    static void copy_subtree(const System *sys, NodeId id, System &reference) {
+        const Node &node = sys->nodes[id.index];
+        reference.nodes[id.index] = node;
+        for (NodeId child_id: node.children) copy_subtree(sys, child_id, reference);
+    }
+
+    // The nodes the reference pass reads, in the slots they have in sys: the subtree, the
+    // ancestors of root for its direction and the anchor targets for their bounds.
+    // Slots outside of them keep whatever an earlier frame left, nothing reaches them.
+    static void copy_inputs(const System *sys, NodeId root, System &reference) {
+        if (reference.nodes.size() < sys->nodes.size()) reference.nodes.resize(sys->nodes.size());
+#if FRAMEFLOW_ENABLE_ANCHORS
+        for (const AnchorLink &link: sys->anchor_links)
+            reference.nodes[link.target.index] = sys->nodes[link.target.index];
+#endif
+        for (NodeId id = sys->nodes[root.index].parent; !id.is_null(); id = sys->nodes[id.index].parent)
+            reference.nodes[id.index] = sys->nodes[id.index];
+        copy_subtree(sys, root, reference);
+    }
+
+    bool compute_layout_validated(System *sys, NodeId root, ShadowValidator *validator) {
+        ++validator->frames;
+        if (!(next_sample(validator->rng) < validator->sample_rate) || !is_valid(sys, root)) {
+            compute_layout(sys, root);
+            return false;
+        }
+        ++validator->sampled;
+
+        // Sizes carry over between passes, so the copy is taken before the active pass
+        System &reference = validator->reference;
+        copy_inputs(sys, root, reference);
+        compute_layout(sys, root);
+
+        // Without fast paths the solver only reads component data, apart from the Box indices
+        // every solve rebuilds from the same inputs, so it's borrowed instead of copied
+        std::swap(reference.components, sys->components);
+        reference.fast_paths = false;
+        compute_layout(&reference, root);
+        std::swap(reference.components, sys->components);
+
+        compare_subtree(sys, reference, root, validator);
+        return true;
+    }
+} // namespace frameflow
@@ -0,0 +1,146 @@
+#include "frameflow/layout_simd.hpp"
+#include "frameflow/layout.hpp"
+#include "simd/kernels_impl.hpp"
+
+#include <atomic>
+
+#if FRAMEFLOW_SIMD_DISPATCH && defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace frameflow {
+    static_assert(sizeof(Rect) == 4 * sizeof(float), "Rect kernels treat rects as 4 floats");
+
+    namespace detail {
+        static void scalar_translate_rects(float *rects, size_t count, float dx, float dy) {
+            for (size_t i = 0; i < count; i++) translate_rect(rects + i * 4, dx, dy);
+        }
+
+        static void scalar_mirror_rects(float *rects, size_t count, float frame_left, float frame_width) {
+            for (size_t i = 0; i < count; i++) mirror_rect(rects + i * 4, frame_left, frame_width);
+        }
+
+        const KernelTable scalar_kernels = {
+            &resolve_anchors_impl<ScalarLane>, &distribute_impl<ScalarLane>, &scalar_translate_rects,
+            &scalar_mirror_rects, &halves_to_floats_impl<ScalarLane>, &floats_to_halves_impl<ScalarLane>
+        };
+    } // namespace detail
+
+    static bool cpu_supports(Isa isa) {
+        if (isa == Isa::Scalar) return true;
+#if FRAMEFLOW_SIMD_DISPATCH && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        switch (isa) {
+            case Isa::Sse4: return __builtin_cpu_supports("sse4.1");
+            case Isa::Avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+            case Isa::Avx512: return __builtin_cpu_supports("avx512f");
+#if FRAMEFLOW_SIMD_AVX512FP16
+            case Isa::Avx512Fp16: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512fp16");
+#endif
+            default: return false;
+        }
+#elif FRAMEFLOW_SIMD_DISPATCH && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int max_leaf = info[0];
+        __cpuid(info, 1);
+        const bool sse4 = (info[2] & (1 << 19)) != 0;
+        const bool f16c = (info[2] & (1 << 29)) != 0;
+        // The OS must save the AVX and AVX-512 registers too
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+        int leaf7[4] = {};
+        if (max_leaf >= 7) __cpuidex(leaf7, 7, 0);
+        switch (isa) {
+            case Isa::Sse4: return sse4;
+            case Isa::Avx2: return (xcr0 & 0x6) == 0x6 && (leaf7[1] & (1 << 5)) != 0 && f16c;
+            case Isa::Avx512: return (xcr0 & 0xe6) == 0xe6 && (leaf7[1] & (1 << 16)) != 0;
+#if FRAMEFLOW_SIMD_AVX512FP16
+            case Isa::Avx512Fp16:
+                return (xcr0 & 0xe6) == 0xe6 && (leaf7[1] & (1 << 16)) != 0 && (leaf7[3] & (1 << 23)) != 0;
+#endif
+            default: return false;
+        }
+#else
+        return false;
+#endif
+    }
+
+    static const detail::KernelTable *kernels_of(Isa isa) {
+        switch (isa) {
+#if FRAMEFLOW_SIMD_DISPATCH
+            case Isa::Sse4: return &detail::sse4_kernels;
+            case Isa::Avx2: return &detail::avx2_kernels;
+            case Isa::Avx512: return &detail::avx512_kernels;
+#if FRAMEFLOW_SIMD_AVX512FP16
+            case Isa::Avx512Fp16: return &detail::avx512fp16_kernels;
+#endif
+#endif
+            default: return &detail::scalar_kernels;
+        }
+    }
+
+    Isa detected_isa() {
+        static const Isa detected = [] {
+            for (Isa isa: {Isa::Avx512Fp16, Isa::Avx512, Isa::Avx2, Isa::Sse4}) {
+                if (cpu_supports(isa)) return isa;
+            }
+            return Isa::Scalar;
+        }();
+        return detected;
+    }
+
+    static std::atomic<int> forced_isa{-1};
+
+    Isa active_isa() {
+        const int forced = forced_isa.load(std::memory_order_relaxed);
+        return forced < 0 ? detected_isa() : static_cast<Isa>(forced);
+    }
+
+    bool force_isa(Isa isa) {
+        if (!cpu_supports(isa)) return false;
+        forced_isa.store(static_cast<int>(isa), std::memory_order_relaxed);
+        return true;
+    }
+
+    const char *isa_name(Isa isa) {
+        switch (isa) {
+            case Isa::Scalar: return "scalar";
+            case Isa::Sse4: return "sse4";
+            case Isa::Avx2: return "avx2";
+            case Isa::Avx512: return "avx512";
+            case Isa::Avx512Fp16: return "avx512fp16";
+        }
+        return "unknown";
+    }
+
+    static const detail::KernelTable &kernels() {
+        return *kernels_of(active_isa());
+    }
+
+    void resolve_anchor_spans(const AnchorSpans &in, bool mirrored, const EdgeSpans &out) {
+        kernels().resolve_anchors(in, mirrored, out);
+    }
+
+    void distribute_spans(const float *sizes, const float *weights, size_t count, float leftover,
+                          float total_weight, float start, float spacing, float *offsets, float *out_sizes) {
+        kernels().distribute(sizes, weights, count, leftover, total_weight, start, spacing, offsets, out_sizes);
+    }
+
+    void translate_rects(Rect *rects, size_t count, float dx, float dy) {
+        kernels().translate_rects(&rects->origin.x, count, dx, dy);
+    }
+
+    void mirror_rects(Rect *rects, size_t count, float frame_left, float frame_width) {
+        kernels().mirror_rects(&rects->origin.x, count, frame_left, frame_width);
+    }
+
+    void halves_to_floats(const uint16_t *in, float *out, size_t count) {
+        kernels().halves_to_floats(in, out, count);
+    }
+
+    void floats_to_halves(const float *in, uint16_t *out, size_t count) {
+        kernels().floats_to_halves(in, out, count);
+    }
+} // namespace frameflow
@@ -0,0 +1,73 @@
+#include "frameflow/layout_stream.hpp"
+#include "layout_internal.hpp"
+
+#include <thread>
+
+namespace frameflow {
+    void init_stream(LayoutStream *stream, size_t capacity) {
+        size_t rounded = 1;
+        while (rounded < capacity) rounded <<= 1;
+
+        stream->slots.assign(rounded, NullNode);
+        stream->mask = static_cast<uint32_t>(rounded - 1);
+        stream->head.store(0, std::memory_order_relaxed);
+        stream->tail.store(0, std::memory_order_relaxed);
+        stream->closed.store(false, std::memory_order_relaxed);
+    }
+
+    static void stream_push(LayoutStream *stream, NodeId id) {
+        const uint32_t tail = stream->tail.load(std::memory_order_relaxed);
+
+        // Full, wait for the consumer to catch up
+        while (tail - stream->head.load(std::memory_order_acquire) > stream->mask)
+            std::this_thread::yield();
+
+        stream->slots[tail & stream->mask] = id;
+        stream->tail.store(tail + 1, std::memory_order_release);
+    }
+
+    bool stream_pop(LayoutStream *stream, NodeId *out) {
+        const uint32_t head = stream->head.load(std::memory_order_relaxed);
+        if (head == stream->tail.load(std::memory_order_acquire)) return false;
+
+        *out = stream->slots[head & stream->mask];
+        stream->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool stream_wait_pop(LayoutStream *stream, NodeId *out) {
+        while (true) {
+            if (stream_pop(stream, out)) return true;
+
+            // Check again after seeing the close, the last push may have raced it
+            if (stream->closed.load(std::memory_order_acquire)) return stream_pop(stream, out);
+
+            std::this_thread::yield();
+        }
+    }
+
+    static void layout_streaming(System *sys, NodeId node_id, bool mirrored, LayoutStream *stream,
+                                 uint32_t depth, uint32_t publish_depth) {
+        Node &node = sys->nodes[node_id.index];
+        detail::solve_node(sys, node, mirrored);
+
+        for (const auto child_id: detail::active_children(sys, node)) {
+            const bool child_mirrored = mirrored || sys->nodes[child_id.index].mirror_x;
+            layout_streaming(sys, child_id, child_mirrored, stream, depth + 1, publish_depth);
+        }
+        detail::include_child_extents(sys, node);
+
+        if (depth == publish_depth || (depth < publish_depth && node.children.empty()))
+            stream_push(stream, node_id);
+    }
+
+    void compute_layout_streaming(System *sys, NodeId root, LayoutStream *stream, uint32_t publish_depth) {
+        stream->closed.store(false, std::memory_order_relaxed);
+
+        detail::begin_pass(sys);
+        if (is_valid(sys, root))
+            layout_streaming(sys, root, detail::is_mirrored(sys, sys->nodes[root.index]), stream, 0, publish_depth);
+
+        stream->closed.store(true, std::memory_order_release);
+    }
+} // namespace frameflow
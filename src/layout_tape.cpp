@@ -0,0 +1,146 @@
+#include "frameflow/layout_tape.hpp"
+#include "layout_internal.hpp"
+
+namespace frameflow {
+    static TapeMode tape_mode(const System *sys, const Node &node) {
+#if FRAMEFLOW_ENABLE_STACK
+        if (node.type == NodeType::Stack) return TapeMode::Recursive;
+#endif
+        if (node.share_children) return TapeMode::Recursive;
+#if FRAMEFLOW_ENABLE_BREAKPOINTS
+        if (node.breakpoint_index == NoBreakpoints) return TapeMode::Fixed;
+        for (const Breakpoint &breakpoint: sys->components.breakpoints[node.breakpoint_index]) {
+#if FRAMEFLOW_ENABLE_STACK
+            if (breakpoint.type == NodeType::Stack) return TapeMode::Recursive;
+#else
+            (void) breakpoint;
+#endif
+        }
+        return TapeMode::Variant;
+#else
+        (void) sys;
+        return TapeMode::Fixed;
+#endif
+    }
+
+    // Finished with solve_leaf by the op of its parent
+    static bool is_leaf(const System *sys, const Node &node) {
+        return node.children.empty() && node.type == NodeType::Generic && tape_mode(sys, node) == TapeMode::Fixed;
+    }
+
+    static void compile_subtree(const System *sys, uint32_t index, uint32_t parent_op, LayoutTape *tape) {
+        const Node &node = sys->nodes[index];
+        const auto op = static_cast<uint32_t>(tape->ops.size());
+        const auto first_leaf = static_cast<uint32_t>(tape->leaves.size());
+        const TapeMode mode = tape_mode(sys, node);
+        tape->ops.push_back({index, parent_op, 0, first_leaf, 0, node.component_index, node.type, mode});
+
+        // The contents of an Embed are in the other System
+        const bool visits_children = mode != TapeMode::Recursive && !(FRAMEFLOW_ENABLE_EMBED &&
+                                                                      node.type == NodeType::Embed);
+        if (visits_children) {
+            for (NodeId child_id: node.children)
+                if (is_leaf(sys, sys->nodes[child_id.index])) tape->leaves.push_back(child_id.index);
+            tape->ops[op].leaf_count = static_cast<uint32_t>(tape->leaves.size()) - first_leaf;
+
+            for (NodeId child_id: node.children)
+                if (!is_leaf(sys, sys->nodes[child_id.index])) compile_subtree(sys, child_id.index, op, tape);
+        }
+        tape->ops[op].end = static_cast<uint32_t>(tape->ops.size());
+    }
+
+    bool compile_layout(System *sys, NodeId root, LayoutTape *tape) {
+        tape->ops.clear();
+        tape->leaves.clear();
+        tape->root = root;
+        tape->structure_version = sys->structure_version;
+        if (!is_valid(sys, root)) return false;
+
+        compile_subtree(sys, root.index, UINT32_MAX, tape);
+        tape->mirrored.assign(tape->ops.size(), 0);
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        tape->extents.resize(tape->ops.size());
+        tape->grown.resize(tape->ops.size());
+#endif
+        return true;
+    }
+
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+    // What layout_subtree does once the children of a node are solved: its extent grows by the
+    // ones of the children with children of their own, in order
+    static void close_op(System *sys, LayoutTape *tape, uint32_t op) {
+        const Node &node = sys->nodes[tape->ops[op].node];
+        const uint32_t parent_op = tape->ops[op].parent_op;
+        if (tape->grown[op]) detail::set_content_extent(sys->nodes[tape->ops[op].node], tape->extents[op]);
+        if (parent_op == UINT32_MAX || node.children.empty()) return;
+
+        tape->extents[parent_op] = detail::rect_union(tape->extents[parent_op], node.content_extent);
+        tape->grown[parent_op] = 1;
+    }
+#endif
+
+    void run_layout_tape(System *sys, LayoutTape *tape) {
+        if (tape->structure_version != sys->structure_version || !is_valid(sys, tape->root)) {
+            if (!compile_layout(sys, tape->root, tape)) return;
+        }
+
+        detail::begin_pass(sys);
+        const TapeOp *ops = tape->ops.data();
+        const uint32_t *leaves = tape->leaves.data();
+        uint8_t *mirrored = tape->mirrored.data();
+        const auto count = static_cast<uint32_t>(tape->ops.size());
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        std::vector<uint32_t> &open = tape->open; // Ops whose subtree is being solved, innermost last
+        open.clear();
+#endif
+
+        for (uint32_t i = 0; i < count;) {
+            const TapeOp &op = ops[i];
+            Node &node = sys->nodes[op.node];
+
+            // Mirroring can change without recompiling, so it is resolved while running
+            const bool parent_mirrored = op.parent_op == UINT32_MAX
+                                             ? detail::is_mirrored(sys, node)
+                                             : mirrored[op.parent_op] != 0;
+            const bool node_mirrored = parent_mirrored || node.mirror_x;
+            mirrored[i] = node_mirrored;
+
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            // The subtrees that ended before this op are solved
+            while (!open.empty() && ops[open.back()].end <= i) {
+                close_op(sys, tape, open.back());
+                open.pop_back();
+            }
+#endif
+
+            switch (op.mode) {
+                case TapeMode::Recursive:
+                    detail::layout_subtree(sys, node, node_mirrored);
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+                    tape->grown[i] = 0;
+                    close_op(sys, tape, i);
+#endif
+                    i = op.end;
+                    continue;
+                case TapeMode::Variant:
+                    detail::solve_as(sys, node, detail::active_variant(sys, node), node_mirrored);
+                    break;
+                case TapeMode::Fixed:
+                    detail::solve_as(sys, node, {0.f, 0.f, op.type, op.component_index}, node_mirrored);
+                    break;
+            }
+            for (uint32_t leaf = op.first_leaf; leaf < op.first_leaf + op.leaf_count; ++leaf)
+                detail::solve_leaf(sys->nodes[leaves[leaf]]);
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+            tape->extents[i] = node.content_extent;
+            tape->grown[i] = 0;
+            open.push_back(i);
+#endif
+            ++i;
+        }
+
+#if FRAMEFLOW_ENABLE_CONTENT_EXTENT
+        for (; !open.empty(); open.pop_back()) close_op(sys, tape, open.back());
+#endif
+    }
+} // namespace frameflow
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "frameflow/layout_simd.hpp"
+
+// Kernel variants behind the dispatch of layout_simd.cpp. Each instruction set lives in its
+// own translation unit built with the matching compiler flags, and only uses internal
+// linkage so no code for a newer CPU leaks into shared inline functions.
+namespace frameflow::detail {
+    struct KernelTable {
+        void (*resolve_anchors)(const AnchorSpans &in, bool mirrored, const EdgeSpans &out);
+        void (*distribute)(const float *sizes, const float *weights, size_t count, float leftover,
+                           float total_weight, float start, float spacing, float *offsets, float *out_sizes);
+        void (*translate_rects)(float *rects, size_t count, float dx, float dy);
+        void (*mirror_rects)(float *rects, size_t count, float frame_left, float frame_width);
+        void (*halves_to_floats)(const uint16_t *in, float *out, size_t count);
+        void (*floats_to_halves)(const float *in, uint16_t *out, size_t count);
+    };
+
+    extern const KernelTable scalar_kernels;
+#if FRAMEFLOW_SIMD_DISPATCH
+    extern const KernelTable sse4_kernels;
+    extern const KernelTable avx2_kernels;
+    extern const KernelTable avx512_kernels;
+#if FRAMEFLOW_SIMD_AVX512FP16
+    extern const KernelTable avx512fp16_kernels;
+#endif
+#endif
+} // namespace frameflow::detail
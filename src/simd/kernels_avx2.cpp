@@ -0,0 +1,39 @@
+// AVX2 kernels, built with -mavx2 -mf16c
+#include "kernels_impl.hpp"
+
+#include <immintrin.h>
+
+namespace frameflow::detail {
+    namespace {
+        struct Avx2Lane {
+            static constexpr size_t width = 8;
+            __m256 v;
+
+            static Avx2Lane load(const float *p) { return {_mm256_loadu_ps(p)}; }
+            static Avx2Lane broadcast(float f) { return {_mm256_set1_ps(f)}; }
+            void store(float *p) const { _mm256_storeu_ps(p, v); }
+
+            static Avx2Lane load_halves(const uint16_t *p) {
+                return {_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)))};
+            }
+            void store_halves(uint16_t *p) const {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+            }
+
+            static Avx2Lane select_nonzero(Avx2Lane key, Avx2Lane a, Avx2Lane b) {
+                return {_mm256_blendv_ps(b.v, a.v, _mm256_cmp_ps(key.v, _mm256_setzero_ps(), _CMP_NEQ_UQ))};
+            }
+
+            // Permutes stay within 128-bit halves, one rect each
+            static Avx2Lane rect_widths(Avx2Lane rect) { return {_mm256_permute_ps(rect.v, _MM_SHUFFLE(3, 2, 3, 2))}; }
+            static Avx2Lane blend_x(Avx2Lane rect, Avx2Lane x) { return {_mm256_blend_ps(rect.v, x.v, 0x11)}; }
+
+            friend Avx2Lane operator+(Avx2Lane a, Avx2Lane b) { return {_mm256_add_ps(a.v, b.v)}; }
+            friend Avx2Lane operator-(Avx2Lane a, Avx2Lane b) { return {_mm256_sub_ps(a.v, b.v)}; }
+            friend Avx2Lane operator*(Avx2Lane a, Avx2Lane b) { return {_mm256_mul_ps(a.v, b.v)}; }
+            friend Avx2Lane operator/(Avx2Lane a, Avx2Lane b) { return {_mm256_div_ps(a.v, b.v)}; }
+        };
+    } // namespace
+
+    const KernelTable avx2_kernels = make_kernels<Avx2Lane>();
+} // namespace frameflow::detail
@@ -0,0 +1,6 @@
+// AVX-512 kernels, built with -mavx512f
+#include "lane_avx512.hpp"
+
+namespace frameflow::detail {
+    const KernelTable avx512_kernels = make_kernels<Avx512Lane>();
+} // namespace frameflow::detail
@@ -0,0 +1,26 @@
+// AVX-512 kernels with the half conversions of AVX-512 FP16, built with -mavx512f -mavx512vl -mavx512fp16
+#include "lane_avx512.hpp"
+
+namespace frameflow::detail {
+    namespace {
+        // Only converts, the float arithmetic is the one of Avx512Lane. The conversions round
+        // as MXCSR says, to nearest even unless the application changed it.
+        struct Avx512Fp16Lane {
+            static constexpr size_t width = 16;
+            __m512 v;
+
+            static Avx512Fp16Lane load(const float *p) { return {_mm512_loadu_ps(p)}; }
+            void store(float *p) const { _mm512_storeu_ps(p, v); }
+
+            static Avx512Fp16Lane load_halves(const uint16_t *p) {
+                const __m256i halves = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                return {_mm512_cvtxph_ps(_mm256_castsi256_ph(halves))};
+            }
+            void store_halves(uint16_t *p) const {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_castph_si256(_mm512_cvtxps_ph(v)));
+            }
+        };
+    } // namespace
+
+    const KernelTable avx512fp16_kernels = make_kernels<Avx512Lane, Avx512Fp16Lane>();
+} // namespace frameflow::detail
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "kernels.hpp"
+#include "frameflow/half.hpp"
+
+// Kernel bodies shared by every variant. V is a vector of V::width floats; each variant runs
+// the same operations per element in the same order (and is built without contraction into
+// fused multiply-adds), so all of them round identically. Only included by the kernel
+// translation units, everything here has internal linkage.
+namespace frameflow::detail {
+    namespace {
+        // One float at a time, the scalar variant and the tails of the others
+        struct ScalarLane {
+            static constexpr size_t width = 1;
+            float v;
+
+            static ScalarLane load(const float *p) { return {*p}; }
+            static ScalarLane broadcast(float f) { return {f}; }
+            void store(float *p) const { *p = v; }
+
+            static ScalarLane load_halves(const uint16_t *p) { return {half_bits_to_float(*p)}; }
+            void store_halves(uint16_t *p) const { *p = float_to_half_bits(v); }
+
+            // a where key is nonzero, b elsewhere
+            static ScalarLane select_nonzero(ScalarLane key, ScalarLane a, ScalarLane b) {
+                return key.v != 0.f ? a : b;
+            }
+
+            friend ScalarLane operator+(ScalarLane a, ScalarLane b) { return {a.v + b.v}; }
+            friend ScalarLane operator-(ScalarLane a, ScalarLane b) { return {a.v - b.v}; }
+            friend ScalarLane operator*(ScalarLane a, ScalarLane b) { return {a.v * b.v}; }
+            friend ScalarLane operator/(ScalarLane a, ScalarLane b) { return {a.v / b.v}; }
+        };
+
+        template<typename V>
+        void anchor_step(const AnchorSpans &in, bool mirrored, const EdgeSpans &out, size_t i) {
+            const V frame_x = V::load(in.frame_x + i);
+            const V frame_y = V::load(in.frame_y + i);
+            const V frame_width = V::load(in.frame_width + i);
+            const V frame_height = V::load(in.frame_height + i);
+
+            V anchor_left = V::load(in.anchor_left + i);
+            V anchor_right = V::load(in.anchor_right + i);
+            V offset_left = V::load(in.offset_left + i);
+            V offset_right = V::load(in.offset_right + i);
+            if (mirrored) {
+                const V one = V::broadcast(1.f);
+                const V left = one - anchor_right;
+                anchor_right = one - anchor_left;
+                anchor_left = left;
+                const V offset = offset_right;
+                offset_right = offset_left;
+                offset_left = offset;
+            }
+
+            (frame_x + anchor_left * frame_width + offset_left).store(out.left + i);
+            (frame_y + V::load(in.anchor_top + i) * frame_height + V::load(in.offset_top + i)).store(out.top + i);
+            (frame_x + anchor_right * frame_width - offset_right).store(out.right + i);
+            (frame_y + V::load(in.anchor_bottom + i) * frame_height - V::load(in.offset_bottom + i))
+                .store(out.bottom + i);
+        }
+
+        template<typename V>
+        void resolve_anchors_impl(const AnchorSpans &in, bool mirrored, const EdgeSpans &out) {
+            size_t i = 0;
+            for (; i + V::width <= in.count; i += V::width) anchor_step<V>(in, mirrored, out, i);
+            for (; i < in.count; i++) anchor_step<ScalarLane>(in, mirrored, out, i);
+        }
+
+        template<typename V>
+        void expand_step(const float *sizes, const float *weights, float leftover, float total_weight,
+                         float *out_sizes, size_t i) {
+            const V size = V::load(sizes + i);
+            const V weight = V::load(weights + i);
+            const V expanded = size + V::broadcast(leftover) * (weight / V::broadcast(total_weight));
+            V::select_nonzero(weight, expanded, size).store(out_sizes + i);
+        }
+
+        template<typename V>
+        void distribute_impl(const float *sizes, const float *weights, size_t count, float leftover,
+                             float total_weight, float start, float spacing, float *offsets, float *out_sizes) {
+            size_t i = 0;
+            if (total_weight > 0.f) {
+                for (; i + V::width <= count; i += V::width)
+                    expand_step<V>(sizes, weights, leftover, total_weight, out_sizes, i);
+                for (; i < count; i++) expand_step<ScalarLane>(sizes, weights, leftover, total_weight, out_sizes, i);
+            } else {
+                for (; i < count; i++) out_sizes[i] = sizes[i];
+            }
+
+            // Offsets are a running sum, kept in order so every variant rounds the same
+            float cursor = start;
+            for (i = 0; i < count; i++) {
+                offsets[i] = cursor;
+                cursor += out_sizes[i] + spacing;
+            }
+        }
+
+        // Rects are stored as x, y, width, height, so a vector of floats holds V::width / 4 of them
+        inline void translate_rect(float *rect, float dx, float dy) {
+            rect[0] += dx;
+            rect[1] += dy;
+        }
+
+        inline void mirror_rect(float *rect, float frame_left, float frame_width) {
+            rect[0] = frame_left + frame_width - (rect[0] - frame_left) - rect[2];
+        }
+
+        template<typename V>
+        void translate_rects_impl(float *rects, size_t count, float dx, float dy) {
+            float pattern[V::width];
+            for (size_t j = 0; j < V::width; j += 4) {
+                pattern[j] = dx;
+                pattern[j + 1] = dy;
+                pattern[j + 2] = 0.f;
+                pattern[j + 3] = 0.f;
+            }
+            const V delta = V::load(pattern);
+
+            size_t i = 0;
+            for (; i + V::width / 4 <= count; i += V::width / 4) (V::load(rects + i * 4) + delta).store(rects + i * 4);
+            for (; i < count; i++) translate_rect(rects + i * 4, dx, dy);
+        }
+
+        template<typename V>
+        void mirror_rects_impl(float *rects, size_t count, float frame_left, float frame_width) {
+            const V left = V::broadcast(frame_left);
+            const V right = V::broadcast(frame_left + frame_width);
+
+            size_t i = 0;
+            for (; i + V::width / 4 <= count; i += V::width / 4) {
+                const V rect = V::load(rects + i * 4);
+                const V x = right - (rect - left) - V::rect_widths(rect);
+                V::blend_x(rect, x).store(rects + i * 4);
+            }
+            for (; i < count; i++) mirror_rect(rects + i * 4, frame_left, frame_width);
+        }
+
+        // Half conversions round to nearest even like the scalar functions of half.hpp
+        template<typename V>
+        void halves_to_floats_impl(const uint16_t *in, float *out, size_t count) {
+            size_t i = 0;
+            for (; i + V::width <= count; i += V::width) V::load_halves(in + i).store(out + i);
+            for (; i < count; i++) ScalarLane::load_halves(in + i).store(out + i);
+        }
+
+        template<typename V>
+        void floats_to_halves_impl(const float *in, uint16_t *out, size_t count) {
+            size_t i = 0;
+            for (; i + V::width <= count; i += V::width) V::load(in + i).store_halves(out + i);
+            for (; i < count; i++) ScalarLane::load(in + i).store_halves(out + i);
+        }
+
+        // H converts halves, for instruction sets whose conversions come from another extension
+        template<typename V, typename H = V>
+        constexpr KernelTable make_kernels() {
+            return {&resolve_anchors_impl<V>, &distribute_impl<V>, &translate_rects_impl<V>, &mirror_rects_impl<V>,
+                    &halves_to_floats_impl<H>, &floats_to_halves_impl<H>};
+        }
+    } // namespace
+} // namespace frameflow::detail
@@ -0,0 +1,33 @@
+// SSE4.1 kernels, built with -msse4.1
+#include "kernels_impl.hpp"
+
+#include <immintrin.h>
+
+namespace frameflow::detail {
+    namespace {
+        struct Sse4Lane {
+            static constexpr size_t width = 4;
+            __m128 v;
+
+            static Sse4Lane load(const float *p) { return {_mm_loadu_ps(p)}; }
+            static Sse4Lane broadcast(float f) { return {_mm_set1_ps(f)}; }
+            void store(float *p) const { _mm_storeu_ps(p, v); }
+
+            static Sse4Lane select_nonzero(Sse4Lane key, Sse4Lane a, Sse4Lane b) {
+                return {_mm_blendv_ps(b.v, a.v, _mm_cmpneq_ps(key.v, _mm_setzero_ps()))};
+            }
+
+            // Width of each rect moved to its x lane, and the x lanes of x blended into rect
+            static Sse4Lane rect_widths(Sse4Lane rect) { return {_mm_shuffle_ps(rect.v, rect.v, _MM_SHUFFLE(3, 2, 3, 2))}; }
+            static Sse4Lane blend_x(Sse4Lane rect, Sse4Lane x) { return {_mm_blend_ps(rect.v, x.v, 0x1)}; }
+
+            friend Sse4Lane operator+(Sse4Lane a, Sse4Lane b) { return {_mm_add_ps(a.v, b.v)}; }
+            friend Sse4Lane operator-(Sse4Lane a, Sse4Lane b) { return {_mm_sub_ps(a.v, b.v)}; }
+            friend Sse4Lane operator*(Sse4Lane a, Sse4Lane b) { return {_mm_mul_ps(a.v, b.v)}; }
+            friend Sse4Lane operator/(Sse4Lane a, Sse4Lane b) { return {_mm_div_ps(a.v, b.v)}; }
+        };
+    } // namespace
+
+    // Hardware half conversions came with F16C, alongside AVX
+    const KernelTable sse4_kernels = make_kernels<Sse4Lane, ScalarLane>();
+} // namespace frameflow::detail
@@ -0,0 +1,42 @@
+#pragma once
+
+// The AVX-512 lane, shared by the AVX-512 and AVX-512 FP16 kernels. Only included by kernel
+// translation units built with -mavx512f or more.
+#include "kernels_impl.hpp"
+
+#include <immintrin.h>
+
+namespace frameflow::detail {
+    namespace {
+        struct Avx512Lane {
+            static constexpr size_t width = 16;
+            __m512 v;
+
+            static Avx512Lane load(const float *p) { return {_mm512_loadu_ps(p)}; }
+            static Avx512Lane broadcast(float f) { return {_mm512_set1_ps(f)}; }
+            void store(float *p) const { _mm512_storeu_ps(p, v); }
+
+            // The zero-masking forms, GCC warns about the undefined register the others start from
+            static Avx512Lane load_halves(const uint16_t *p) {
+                return {_mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)))};
+            }
+            void store_halves(uint16_t *p) const {
+                const __m256i halves = _mm512_maskz_cvtps_ph(0xffff, v, _MM_FROUND_TO_NEAREST_INT);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), halves);
+            }
+
+            static Avx512Lane select_nonzero(Avx512Lane key, Avx512Lane a, Avx512Lane b) {
+                return {_mm512_mask_blend_ps(_mm512_cmp_ps_mask(key.v, _mm512_setzero_ps(), _CMP_NEQ_UQ), b.v, a.v)};
+            }
+
+            // Permutes stay within 128-bit quarters, one rect each
+            static Avx512Lane rect_widths(Avx512Lane rect) { return {_mm512_shuffle_ps(rect.v, rect.v, _MM_SHUFFLE(3, 2, 3, 2))}; }
+            static Avx512Lane blend_x(Avx512Lane rect, Avx512Lane x) { return {_mm512_mask_blend_ps(0x1111, rect.v, x.v)}; }
+
+            friend Avx512Lane operator+(Avx512Lane a, Avx512Lane b) { return {_mm512_add_ps(a.v, b.v)}; }
+            friend Avx512Lane operator-(Avx512Lane a, Avx512Lane b) { return {_mm512_sub_ps(a.v, b.v)}; }
+            friend Avx512Lane operator*(Avx512Lane a, Avx512Lane b) { return {_mm512_mul_ps(a.v, b.v)}; }
+            friend Avx512Lane operator/(Avx512Lane a, Avx512Lane b) { return {_mm512_div_ps(a.v, b.v)}; }
+        };
+    } // namespace
+} // namespace frameflow::detail
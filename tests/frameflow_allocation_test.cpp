@@ -1,9 +1,12 @@
 #include <frameflow/layout.hpp>
+#include <frameflow/layout_async.hpp>
 #include <iostream>
 #include <cassert>
 #include <vector>
 #include <random>
 #include <algorithm>
+#include <functional>
+#include <thread>
 
 using namespace frameflow;
 
@@ -454,6 +457,58 @@ TEST(parallel_subtree_operations) {
     }
 }
 
+TEST(destroy_system_async_frees_off_thread) {
+    System sys;
+    NodeId root = add_generic(&sys, NullNode);
+    for (int i = 0; i < 1000; i++) {
+        add_box(&sys, add_generic(&sys, root), {Direction::Horizontal, Align::Start});
+    }
+
+    std::thread worker;
+    destroy_system_async(std::move(sys), [&](std::function<void()> task) {
+        worker = std::thread(std::move(task));
+    });
+
+    // The System is usable again right away
+    ASSERT_TRUE(sys.nodes.empty());
+    ASSERT_TRUE(sys.components.boxes.empty());
+    NodeId fresh = add_generic(&sys, NullNode);
+    ASSERT_TRUE(is_valid(&sys, fresh));
+
+    worker.join();
+    std::cout << "    Freed 2001 nodes on a worker thread" << std::endl;
+}
+
+TEST(release_subtree_async_defers_memory) {
+    System sys;
+    NodeId root = add_generic(&sys, NullNode);
+    NodeId panel = add_generic(&sys, root);
+
+    std::vector<NodeId> rows;
+    for (int i = 0; i < 500; i++) {
+        NodeId row = add_generic(&sys, panel);
+        add_generic(&sys, row);
+        rows.push_back(row);
+    }
+
+    std::vector<std::function<void()>> pending;
+    ASSERT_TRUE(release_subtree_async(&sys, panel, [&](std::function<void()> task) {
+        pending.push_back(std::move(task));
+    }));
+
+    // Handles are invalid immediately, the memory is not released yet
+    ASSERT_FALSE(is_valid(&sys, panel));
+    for (NodeId row : rows) {
+        ASSERT_FALSE(is_valid(&sys, row));
+    }
+    ASSERT_EQ(get_node(&sys, root)->children.size(), 0);
+    ASSERT_EQ(pending.size(), 1);
+    ASSERT_EQ(sys.free_list.size(), 1001);
+
+    pending.front()();
+    ASSERT_FALSE(release_subtree_async(&sys, panel, {}));
+}
+
 // ========== Main ==========
 
 int main() {
@@ -467,6 +522,8 @@ int main() {
     RUN_TEST(deep_tree_with_mixed_types);
     RUN_TEST(cascade_deletion);
     RUN_TEST(parallel_subtree_operations);
+    RUN_TEST(destroy_system_async_frees_off_thread);
+    RUN_TEST(release_subtree_async_defers_memory);
     
     std::cout << "\n✓ All allocator stress tests passed!" << std::endl;
     return 0;
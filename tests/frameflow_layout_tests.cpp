@@ -1,7 +1,19 @@
+#include <frameflow/half.hpp>
 #include <frameflow/layout.hpp>
+#include <frameflow/layout_cache.hpp>
+#include <frameflow/layout_history.hpp>
+#include <frameflow/layout_kernels.hpp>
+#include <frameflow/layout_shadow.hpp>
+#include <frameflow/layout_simd.hpp>
+#include <frameflow/layout_stream.hpp>
+#include <frameflow/layout_tape.hpp>
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 using namespace frameflow;
 
@@ -141,6 +153,60 @@ TEST(reparent_to_self_fails) {
     ASSERT_FALSE(reparent_node(&sys, node, node));
 }
 
+TEST(transfer_subtree_between_systems) {
+    System a, b;
+    NodeId root_a = add_generic(&a, NullNode);
+    NodeId outside = add_generic(&a, root_a);
+    BoxId panel = add_box(&a, root_a, {Direction::Vertical, Align::Start});
+    MarginId inset = add_margin(&a, panel, {4, 4, 4, 4});
+    NodeId label = add_generic(&a, inset);
+    NodeId badge = add_generic(&a, panel);
+    NodeId tip = add_generic(&a, panel);
+    add_box_breakpoint(&a, panel, 0, 50, {Direction::Horizontal, Align::Start});
+    get_node(&a, label)->minimum_size = {30, 10};
+    get_node(&a, badge)->minimum_size = {10, 10};
+    set_anchor_target(&a, tip, label);
+    set_anchor_target(&a, badge, outside);
+    get_node(&a, panel)->bounds = {{0, 0}, {100, 100}};
+    compute_layout(&a, panel);
+    const Rect label_before = get_node(&a, label)->bounds;
+
+    NodeId root_b = add_generic(&b, NullNode);
+    std::vector<NodeMapping> mapping = transfer_subtree(&a, panel, &b, root_b);
+    ASSERT_EQ(mapping.size(), 5);
+    ASSERT_FALSE(is_valid(&a, panel));
+    ASSERT_FALSE(is_valid(&a, label));
+    ASSERT_EQ(get_node(&a, root_a)->children.size(), 1);
+    ASSERT_TRUE(a.components.free_boxes.size() == 2); // Own data and the breakpoint's
+
+    BoxId moved{remap_node(mapping, panel)};
+    NodeId moved_label = remap_node(mapping, label);
+    ASSERT_EQ(get_node(&b, root_b)->children[0], moved);
+    ASSERT_EQ(get_node(&b, moved_label)->parent, remap_node(mapping, inset));
+    ASSERT_EQ(get_box_data(&b, moved)->direction, Direction::Vertical);
+    ASSERT_EQ(get_node(&b, remap_node(mapping, tip))->anchor_target, moved_label);
+    ASSERT_TRUE(get_node(&b, remap_node(mapping, badge))->anchor_target.is_null());
+    ASSERT_TRUE(remap_node(mapping, outside).is_null());
+    ASSERT_TRUE(a.anchor_links.empty());
+    ASSERT_EQ(b.anchor_links.size(), 1u); // The tip's, the badge's target stayed behind
+
+    // Same layout in the new System, breakpoints included
+    get_node(&b, moved)->bounds = {{0, 0}, {100, 100}};
+    compute_layout(&b, moved);
+    ASSERT_NEAR(get_node(&b, moved_label)->bounds.origin.y, label_before.origin.y, 0.01);
+    ASSERT_NEAR(get_node(&b, moved_label)->bounds.size.x, label_before.size.x, 0.01);
+    get_node(&b, moved)->bounds.size.x = 40;
+    compute_layout(&b, moved);
+    ASSERT_EQ(get_active_type(&b, moved), NodeType::Box);
+    ASSERT_NEAR(get_node(&b, remap_node(mapping, badge))->bounds.origin.y, 0, 0.01);
+
+    // Within one System it is a reparent, handles are kept
+    mapping = transfer_subtree(&b, moved, &b, NullNode);
+    ASSERT_EQ(mapping.size(), 5);
+    ASSERT_EQ(remap_node(mapping, moved_label), moved_label);
+    ASSERT_TRUE(get_node(&b, moved)->parent.is_null());
+}
+
 // ========== Generic Layout Tests ==========
 
 TEST(generic_respects_minimum_size) {
@@ -263,6 +329,24 @@ TEST(center_centers_child) {
     ASSERT_NEAR(child_node->bounds.size.y, 20, 0.01);
 }
 
+TEST(center_percent_size) {
+    System sys;
+    NodeId root = add_center(&sys, NullNode);
+    NodeId child = add_generic(&sys, root);
+
+    get_node(&sys, root)->bounds = {{0, 0}, {200, 100}};
+
+    Node* child_node = get_node(&sys, child);
+    child_node->percent_size = {0.3f, 0.5f};
+
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(child_node->bounds.size.x, 60, 0.01);
+    ASSERT_NEAR(child_node->bounds.size.y, 50, 0.01);
+    ASSERT_NEAR(child_node->bounds.origin.x, 70, 0.01);
+    ASSERT_NEAR(child_node->bounds.origin.y, 25, 0.01);
+}
+
 // ========== Box Layout Tests ==========
 
 TEST(box_horizontal_basic) {
@@ -411,6 +495,113 @@ TEST(box_vertical_basic) {
     ASSERT_NEAR(c2->bounds.origin.y, 30, 0.01);
 }
 
+TEST(box_percent_and_aspect_ratio) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId child1 = add_generic(&sys, root);
+    NodeId child2 = add_generic(&sys, root);
+
+    get_node(&sys, root)->bounds = {{0, 0}, {200, 100}};
+
+    Node* c1 = get_node(&sys, child1);
+    c1->percent_size = {0.25f, 0};
+    c1->aspect_ratio = 2.f;  // height follows width
+
+    Node* c2 = get_node(&sys, child2);
+    c2->minimum_size = {10, 40};
+    c2->aspect_ratio = 0.5f; // width would be 20, but minimum height drives it
+
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(c1->bounds.size.x, 50, 0.01);
+    ASSERT_NEAR(c1->bounds.size.y, 25, 0.01);
+    ASSERT_NEAR(c2->bounds.origin.x, 50, 0.01);
+    ASSERT_NEAR(c2->bounds.size.x, 20, 0.01);
+    ASSERT_NEAR(c2->bounds.size.y, 40, 0.01);
+}
+
+// ========== Indexed Box Tests ==========
+
+// Index queries agree with the solved bounds of every child
+static void check_box_index(System *sys, BoxId box) {
+    const Node *node = get_node(sys, box);
+    const bool horizontal = get_box_data(sys, box)->direction == Direction::Horizontal;
+    for (uint32_t i = 0; i < node->children.size(); i++) {
+        const Rect bounds = get_node(sys, node->children[i])->bounds;
+        const float start = horizontal ? bounds.origin.x - node->bounds.origin.x : bounds.origin.y - node->bounds.origin.y;
+        float offset = -1.f, size = -1.f;
+        ASSERT_TRUE(get_box_child_span(sys, box, i, &offset, &size));
+        ASSERT_NEAR(offset, start, 0.01);
+        ASSERT_NEAR(size, horizontal ? bounds.size.x : bounds.size.y, 0.01);
+        if (size > 0.f) ASSERT_EQ(find_box_child(sys, box, start + size * 0.5f), i);
+    }
+}
+
+TEST(indexed_box_queries_match_layout) {
+    System sys;
+    BoxId list = add_box(&sys, NullNode, {Direction::Vertical, Align::Start, true});
+    std::vector<NodeId> rows;
+    for (int i = 0; i < 1000; i++) {
+        NodeId row = add_generic(&sys, list);
+        get_node(&sys, row)->minimum_size = {50, static_cast<float>(10 + i % 7)};
+        if (i % 100 == 0) get_node(&sys, row)->expand = {0, 1};
+        rows.push_back(row);
+    }
+    get_node(&sys, list)->bounds = {{0, 100}, {200, 20000}};
+
+    compute_layout(&sys, list);
+    check_box_index(&sys, list);
+    ASSERT_EQ(find_box_child(&sys, list, -5.f), 0);
+    ASSERT_EQ(find_box_child(&sys, list, 1e9f), 999);
+
+    // One row grows: the queries see it before the next layout, which agrees
+    get_node(&sys, rows[500])->minimum_size.y = 300;
+    ASSERT_TRUE(update_box_child(&sys, list, 500));
+    float before = 0.f, after = 0.f;
+    get_box_child_span(&sys, list, 100, &before, nullptr);
+    get_box_child_span(&sys, list, 501, &after, nullptr);
+    compute_layout(&sys, list);
+    ASSERT_NEAR(get_node(&sys, rows[100])->bounds.origin.y - 100, before, 0.01);
+    ASSERT_NEAR(get_node(&sys, rows[501])->bounds.origin.y - 100, after, 0.01);
+    check_box_index(&sys, list);
+
+    ASSERT_FALSE(update_box_child(&sys, list, 1000));
+    BoxId plain = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    add_generic(&sys, plain);
+    ASSERT_EQ(find_box_child(&sys, plain, 0.f), NoChildIndex);
+}
+
+TEST(indexed_box_alignment_and_structure_changes) {
+    System sys;
+    BoxId row = add_box(&sys, NullNode, {Direction::Horizontal, Align::SpaceBetween, true});
+    for (int i = 0; i < 5; i++) get_node(&sys, add_generic(&sys, row))->minimum_size = {10.f * (i + 1), 10};
+    get_node(&sys, row)->bounds = {{20, 0}, {300, 10}};
+    compute_layout(&sys, row);
+    check_box_index(&sys, row);
+
+    // Adding a child and resizing the box rebuild the index on the next query
+    NodeId wide = add_generic(&sys, row);
+    get_node(&sys, wide)->minimum_size = {40, 10};
+    get_node(&sys, wide)->expand = {1, 0};
+    get_node(&sys, row)->bounds.size.x = 400;
+    ASSERT_EQ(find_box_child(&sys, row, 399.f), 5);
+    compute_layout(&sys, row);
+    check_box_index(&sys, row);
+
+    ASSERT_TRUE(set_box_data(&sys, row, {Direction::Horizontal, Align::Center, true}));
+    delete_node(&sys, wide);
+    compute_layout(&sys, row);
+    check_box_index(&sys, row);
+
+    // Mirrored, offsets count from the right edge
+    set_mirror_x(&sys, row, true);
+    compute_layout(&sys, row);
+    float offset = 0.f;
+    get_box_child_span(&sys, row, 0, &offset, nullptr);
+    const Rect first = get_node(&sys, get_node(&sys, row)->children[0])->bounds;
+    ASSERT_NEAR(20 + 400 - offset - 10, first.origin.x, 0.01);
+}
+
 // ========== Flow Layout Tests ==========
 
 TEST(flow_horizontal_no_wrap) {
@@ -475,6 +666,100 @@ TEST(flow_horizontal_with_wrap) {
     ASSERT_NEAR(c3->bounds.origin.y, 20, 0.01);
 }
 
+TEST(flow_height_for_width_in_vertical_box) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId flow = add_flow(&sys, root, {Direction::Horizontal, Align::Start});
+    NodeId footer = add_generic(&sys, root);
+
+    // Five 30px items wrap into three rows at 70px
+    for (int i = 0; i < 5; i++)
+        get_node(&sys, add_generic(&sys, flow))->minimum_size = {30, 20};
+
+    get_node(&sys, root)->bounds = {{0, 0}, {70, 300}};
+
+    Node* flow_node = get_node(&sys, flow);
+    flow_node->anchors = {0, 0, 1, 0};  // Fill the box width
+    flow_node->minimum_size = {0, 10};
+
+    get_node(&sys, footer)->minimum_size = {70, 15};
+
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(flow_node->bounds.size.y, 60, 0.01);
+    ASSERT_NEAR(get_node(&sys, footer)->bounds.origin.y, 60, 0.01);
+
+    // Wider box, two rows, still a single pass
+    get_node(&sys, root)->bounds.size.x = 100;
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(flow_node->bounds.size.y, 40, 0.01);
+    ASSERT_NEAR(get_node(&sys, footer)->bounds.origin.y, 40, 0.01);
+}
+
+TEST(height_for_width_through_margin) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId margin = add_margin(&sys, root, {5, 5, 5, 5});
+    NodeId flow = add_flow(&sys, margin, {Direction::Horizontal, Align::Start});
+    NodeId footer = add_generic(&sys, root);
+
+    get_node(&sys, root)->bounds = {{0, 0}, {70, 300}};
+    get_node(&sys, margin)->anchors = {0, 0, 1, 0};
+    get_node(&sys, flow)->expand = {1, 0};
+
+    // 60px inner width fits two items per row
+    for (int i = 0; i < 3; i++)
+        get_node(&sys, add_generic(&sys, flow))->minimum_size = {30, 20};
+
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(get_node(&sys, margin)->bounds.size.y, 50, 0.01);
+    ASSERT_NEAR(get_node(&sys, flow)->bounds.size.y, 40, 0.01);
+    ASSERT_NEAR(get_node(&sys, footer)->bounds.origin.y, 50, 0.01);
+}
+
+TEST(wrapping_content_follows_structure_changes) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId margin = add_margin(&sys, root, {5, 5, 5, 5});
+    NodeId panel = add_generic(&sys, NullNode);
+    get_node(&sys, root)->bounds = {{0, 0}, {70, 300}};
+    get_node(&sys, margin)->anchors = {0, 0, 1, 0};
+    ASSERT_FALSE(get_node(&sys, root)->subtree_wraps);
+
+    // A Flow below the margin makes it measured, three 30px items in two rows
+    NodeId flow = add_flow(&sys, panel, {Direction::Horizontal, Align::Start});
+    get_node(&sys, flow)->expand = {1, 0};
+    for (int i = 0; i < 3; i++) get_node(&sys, add_generic(&sys, flow))->minimum_size = {30, 20};
+    ASSERT_TRUE(get_node(&sys, panel)->subtree_wraps);
+    reparent_node(&sys, flow, margin);
+    ASSERT_FALSE(get_node(&sys, panel)->subtree_wraps);
+    ASSERT_TRUE(get_node(&sys, root)->subtree_wraps);
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, margin)->bounds.size.y, 50, 0.01);
+
+    // Without it the margin keeps its minimum height
+    System target;
+    NodeId host = add_generic(&target, NullNode);
+    std::vector<NodeMapping> mapping = transfer_subtree(&sys, flow, &target, host);
+    ASSERT_FALSE(get_node(&sys, root)->subtree_wraps);
+    ASSERT_TRUE(get_node(&target, host)->subtree_wraps);
+    NodeId label = add_generic(&sys, margin);
+    get_node(&sys, label)->minimum_size = {30, 20};
+    get_node(&sys, margin)->minimum_size = {0, 12};
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, margin)->bounds.size.y, 12, 0.01);
+    delete_node(&target, remap_node(mapping, flow));
+    ASSERT_FALSE(get_node(&target, host)->subtree_wraps);
+
+    // Breakpoints to a wrapping type count, until they're cleared
+    ASSERT_TRUE(add_flow_breakpoint(&sys, label, 0.f, 1000.f, {Direction::Horizontal, Align::Start}));
+    ASSERT_TRUE(get_node(&sys, root)->subtree_wraps);
+    ASSERT_TRUE(clear_breakpoints(&sys, label));
+    ASSERT_FALSE(get_node(&sys, root)->subtree_wraps);
+}
+
 // ========== Margin Layout Tests ==========
 
 TEST(margin_insets_children) {
@@ -519,114 +804,1944 @@ TEST(margin_asymmetric) {
     ASSERT_NEAR(child_node->bounds.size.y, 70, 0.01);  // 100 - 10 - 20
 }
 
-// ========== Complex Nested Tests ==========
+TEST(margin_percent_uses_inner_size) {
+    System sys;
+    NodeId root = add_margin(&sys, NullNode, {10, 10, 10, 10});
+    NodeId child = add_generic(&sys, root);
 
-TEST(nested_box_in_center) {
+    get_node(&sys, root)->bounds = {{0, 0}, {120, 120}};
+
+    Node* child_node = get_node(&sys, child);
+    child_node->percent_size = {0, 0.5f};
+    child_node->aspect_ratio = 1.f;  // width follows the percentage height
+
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(child_node->bounds.size.x, 50, 0.01);
+    ASSERT_NEAR(child_node->bounds.size.y, 50, 0.01);
+}
+
+// ========== Typed Handle Tests ==========
+
+TEST(set_component_data_relays_out_container) {
     System sys;
-    NodeId center = add_center(&sys, NullNode);
-    NodeId box = add_box(&sys, center, {Direction::Horizontal, Align::Start});
-    NodeId child1 = add_generic(&sys, box);
-    NodeId child2 = add_generic(&sys, box);
-    
-    Node* center_node = get_node(&sys, center);
-    center_node->bounds = {{0, 0}, {200, 200}};
-    
-    Node* box_node = get_node(&sys, box);
-    box_node->minimum_size = {100, 50};
-    
-    Node* c1 = get_node(&sys, child1);
-    c1->minimum_size = {40, 50};
-    
-    Node* c2 = get_node(&sys, child2);
-    c2->minimum_size = {60, 50};
-    
-    compute_layout(&sys, center);
-    
-    // Box should be centered
-    ASSERT_NEAR(box_node->bounds.origin.x, 50, 0.01);  // (200-100)/2
-    ASSERT_NEAR(box_node->bounds.origin.y, 75, 0.01);  // (200-50)/2
-    
-    // Children should be laid out horizontally within box
-    ASSERT_NEAR(c1->bounds.origin.x, 50, 0.01);
-    ASSERT_NEAR(c2->bounds.origin.x, 90, 0.01);
+    NodeId root = add_generic(&sys, NullNode);
+    MarginId margin = add_margin(&sys, root, {5, 5, 5, 5});
+    BoxId box = add_box(&sys, margin, {Direction::Horizontal, Align::Start});
+    NodeId a = add_generic(&sys, box);
+    NodeId b = add_generic(&sys, box);
+    get_node(&sys, margin)->expand = {1, 1};
+    get_node(&sys, box)->expand = {1, 1};
+    get_node(&sys, a)->minimum_size = {10, 10};
+    get_node(&sys, b)->minimum_size = {10, 10};
+    get_node(&sys, root)->bounds = {{0, 0}, {100, 100}};
+
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, b)->bounds.origin.x, 15, 0.01);
+    ASSERT_EQ(get_box_data(&sys, box)->direction, Direction::Horizontal);
+
+    ASSERT_TRUE(set_box_data(&sys, box, {Direction::Vertical, Align::Start}));
+    ASSERT_EQ(get_box_data(&sys, box)->direction, Direction::Vertical);
+    Rect bounds = get_bounds(&sys, b);
+    ASSERT_NEAR(bounds.origin.x, 5, 0.01);
+    ASSERT_NEAR(bounds.origin.y, 15, 0.01);
+
+    ASSERT_TRUE(set_margin_data(&sys, margin, {20, 0, 0, 0}));
+    ASSERT_NEAR(get_bounds(&sys, a).origin.x, 20, 0.01);
+
+    // A deleted handle is rejected, even once its slot is reused
+    delete_node(&sys, box);
+    add_box(&sys, margin, {});
+    ASSERT_TRUE(get_box_data(&sys, box) == nullptr);
+    ASSERT_FALSE(set_box_data(&sys, box, {}));
+
+    // So is a handle made from a node of another type, its component index is another pool's
+    ASSERT_TRUE(get_box_data(&sys, BoxId{margin}) == nullptr);
+    ASSERT_FALSE(set_box_data(&sys, BoxId{margin}, {}));
+    ASSERT_FALSE(set_margin_data(&sys, MarginId{root}, {}));
+    ASSERT_EQ(find_box_child(&sys, BoxId{margin}, 0), NoChildIndex);
+    ASSERT_NEAR(get_margin_data(&sys, margin)->left, 20, 0.01);
 }
 
-// ========== Edge Cases ==========
+// ========== Content Extent Tests ==========
 
-TEST(empty_children_doesnt_crash) {
+TEST(content_extent_and_overflow) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId a = add_generic(&sys, root);
+    NodeId b = add_generic(&sys, root);
+    NodeId leaf = add_generic(&sys, a);
+    get_node(&sys, root)->bounds = {{10, 10}, {100, 50}};
+    get_node(&sys, a)->minimum_size = {60, 30};
+    get_node(&sys, b)->minimum_size = {80, 30};
+    get_node(&sys, leaf)->anchors = {0, 0, 1, 0}; // Across the top of a
+    get_node(&sys, leaf)->offsets = {0, 0, 0, -10};
+
+    compute_layout(&sys, root);
+    const Node* r = get_node(&sys, root);
+    ASSERT_NEAR(r->content_extent.origin.x, 10, 0.01);
+    ASSERT_NEAR(r->content_extent.origin.y, 10, 0.01);
+    ASSERT_NEAR(r->content_extent.size.x, 80, 0.01);
+    ASSERT_NEAR(r->content_extent.size.y, 60, 0.01);
+    ASSERT_TRUE(r->overflow);
+
+    // Leaves have an empty extent at their origin
+    ASSERT_NEAR(get_node(&sys, leaf)->content_extent.size.x, 0, 0.01);
+    ASSERT_FALSE(get_node(&sys, leaf)->overflow);
+
+    get_node(&sys, root)->bounds.size.y = 60;
+    compute_layout(&sys, root);
+    ASSERT_FALSE(get_node(&sys, root)->overflow);
+
+    // A grandchild reaching out of its parent grows the extents of every ancestor
+    get_node(&sys, leaf)->offsets.bottom = -50;
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, a)->content_extent.size.y, 50, 0.01);
+    ASSERT_NEAR(r->content_extent.size.y, 60, 0.01);
+    get_node(&sys, leaf)->offsets.bottom = -80;
+    compute_layout(&sys, root);
+    ASSERT_TRUE(get_node(&sys, a)->overflow);
+    ASSERT_NEAR(r->content_extent.size.y, 80, 0.01);
+    ASSERT_TRUE(r->overflow);
+    get_node(&sys, leaf)->offsets.bottom = -10;
+    compute_layout(&sys, root);
+    ASSERT_FALSE(r->overflow);
+
+    // Mirroring moves the extent with the children
+    set_mirror_x(&sys, root, true);
+    ASSERT_NEAR(get_node(&sys, root)->content_extent.origin.x, 30, 0.01);
+}
+
+// ========== User Flag Tests ==========
+
+TEST(subtree_flags_follow_structure_changes) {
+    constexpr uint32_t Interactive = 1, Text = 2;
+    System sys;
+    NodeId root = add_generic(&sys, NullNode);
+    NodeId panel = add_generic(&sys, root);
+    NodeId button = add_generic(&sys, panel);
+    NodeId label = add_generic(&sys, panel);
+    NodeId other = add_generic(&sys, NullNode);
+
+    ASSERT_TRUE(set_node_flags(&sys, button, Interactive | Text));
+    ASSERT_TRUE(set_node_flags(&sys, label, Text));
+    ASSERT_EQ(get_node(&sys, root)->subtree_flags, Interactive | Text);
+
+    std::vector<NodeId> found;
+    find_nodes(&sys, root, Text, &found);
+    ASSERT_EQ(found.size(), 2);
+    found.clear();
+    find_nodes(&sys, root, Interactive | Text, &found);
+    ASSERT_EQ(found.size(), 1);
+    ASSERT_EQ(found[0], button);
+
+    set_node_flags(&sys, button, Text);
+    ASSERT_EQ(get_node(&sys, root)->subtree_flags, Text);
+
+    reparent_node(&sys, label, other);
+    ASSERT_EQ(get_node(&sys, other)->subtree_flags, Text);
+    ASSERT_EQ(get_node(&sys, panel)->subtree_flags, Text);
+    delete_node(&sys, button);
+    ASSERT_EQ(get_node(&sys, root)->subtree_flags, 0);
+
+    // Flags travel with transferred subtrees
+    System target;
+    NodeId host = add_generic(&target, NullNode);
+    std::vector<NodeMapping> mapping = transfer_subtree(&sys, label, &target, host);
+    ASSERT_EQ(get_node(&sys, other)->subtree_flags, 0);
+    ASSERT_EQ(get_node(&target, host)->subtree_flags, Text);
+    ASSERT_EQ(get_node(&target, remap_node(mapping, label))->flags, Text);
+
+    // Reused slots start without flags
+    NodeId fresh = add_generic(&sys, root);
+    ASSERT_EQ(get_node(&sys, fresh)->flags, 0);
+    ASSERT_EQ(get_node(&sys, root)->subtree_flags, 0);
+}
+
+TEST(hit_test_prunes_by_flags_and_extent) {
+    constexpr uint32_t Interactive = 1;
     System sys;
     NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
-    
-    Node* root_node = get_node(&sys, root);
-    root_node->bounds = {{0, 0}, {100, 100}};
-    
-    compute_layout(&sys, root);  // Should not crash
+    NodeId left = add_generic(&sys, root);
+    NodeId right = add_generic(&sys, root);
+    NodeId popup = add_generic(&sys, right); // Overflows below its parent
+    StackId tabs = add_stack(&sys, root);
+    NodeId hidden = add_generic(&sys, tabs);
+    NodeId shown = add_generic(&sys, tabs);
+    get_node(&sys, root)->bounds = {{0, 0}, {300, 50}};
+    get_node(&sys, left)->minimum_size = {100, 50};
+    get_node(&sys, right)->minimum_size = {100, 50};
+    get_node(&sys, tabs)->minimum_size = {100, 50};
+    get_node(&sys, popup)->anchors = {0, 1, 1, 1};
+    get_node(&sys, popup)->offsets = {0, 0, 0, -80};
+    get_node(&sys, hidden)->anchors = {0, 0, 1, 1};
+    get_node(&sys, shown)->anchors = {0, 0, 1, 1};
+    set_active_page(&sys, tabs, 1);
+    for (NodeId id: {left, popup, hidden, shown}) set_node_flags(&sys, id, Interactive);
+    compute_layout(&sys, root);
+
+    ASSERT_EQ(hit_test(&sys, root, {50, 25}, Interactive), left);
+    ASSERT_EQ(hit_test(&sys, root, {150, 25}, Interactive), NullNode); // right isn't interactive
+    ASSERT_EQ(hit_test(&sys, root, {150, 25}, 0), right);
+    // The popup overflows its parent, the extents of its parent and of the root cover it
+    ASSERT_EQ(hit_test(&sys, right, {150, 100}, Interactive), popup);
+    ASSERT_EQ(hit_test(&sys, root, {150, 100}, Interactive), popup);
+    ASSERT_EQ(hit_test(&sys, root, {150, 200}, Interactive), NullNode);
+    ASSERT_EQ(hit_test(&sys, root, {250, 25}, Interactive), shown);
+    ASSERT_EQ(hit_test(&sys, root, {400, 25}, 0), NullNode);
+
+    set_node_flags(&sys, popup, 0);
+    ASSERT_EQ(hit_test(&sys, right, {150, 100}, Interactive), NullNode);
 }
 
-TEST(zero_size_parent) {
+// ========== Breakpoint Tests ==========
+
+TEST(breakpoint_switches_box_direction) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId child1 = add_generic(&sys, root);
+    NodeId child2 = add_generic(&sys, root);
+
+    // Narrow screens stack vertically
+    ASSERT_TRUE(add_box_breakpoint(&sys, root, 0, 400, {Direction::Vertical, Align::Start}));
+
+    Node* c1 = get_node(&sys, child1);
+    c1->minimum_size = {100, 30};
+    Node* c2 = get_node(&sys, child2);
+    c2->minimum_size = {100, 30};
+
+    get_node(&sys, root)->bounds = {{0, 0}, {800, 100}};
+    compute_layout(&sys, root);
+
+    ASSERT_EQ(get_active_type(&sys, root), NodeType::Box);
+    ASSERT_NEAR(c2->bounds.origin.x, 100, 0.01);
+    ASSERT_NEAR(c2->bounds.origin.y, 0, 0.01);
+
+    get_node(&sys, root)->bounds = {{0, 0}, {300, 100}};
+    compute_layout(&sys, root);
+
+    ASSERT_NEAR(c2->bounds.origin.x, 0, 0.01);
+    ASSERT_NEAR(c2->bounds.origin.y, 30, 0.01);
+}
+
+TEST(breakpoint_changes_node_type) {
     System sys;
     NodeId root = add_generic(&sys, NullNode);
     NodeId child = add_generic(&sys, root);
-    
-    Node* root_node = get_node(&sys, root);
-    root_node->bounds = {{0, 0}, {0, 0}};
-    
-    Node* child_node = get_node(&sys, child);
-    child_node->expand = {1, 1};
-    
+
+    ASSERT_TRUE(add_breakpoint(&sys, root, 500, 1000, NodeType::Center));
+    ASSERT_FALSE(add_breakpoint(&sys, root, 0, 100, NodeType::Box));
+
+    get_node(&sys, child)->minimum_size = {20, 20};
+
+    get_node(&sys, root)->bounds = {{0, 0}, {600, 100}};
     compute_layout(&sys, root);
-    
-    // Should not crash, child should be 0 size
-    ASSERT_NEAR(child_node->bounds.size.x, 0, 0.01);
-    ASSERT_NEAR(child_node->bounds.size.y, 0, 0.01);
+
+    ASSERT_EQ(get_active_type(&sys, root), NodeType::Center);
+    ASSERT_NEAR(get_node(&sys, child)->bounds.origin.x, 290, 0.01);
+
+    ASSERT_TRUE(clear_breakpoints(&sys, root));
+    ASSERT_EQ(get_active_type(&sys, root), NodeType::Generic);
 }
 
-// ========== Main ==========
+TEST(breakpoint_measured_at_the_new_width) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId card = add_generic(&sys, root);
+    NodeId row = add_generic(&sys, card);
+    get_node(&sys, card)->minimum_size = {0, 20};
+    get_node(&sys, card)->anchors = {0, 0, 1, 0};
+    get_node(&sys, row)->anchors = {0, 0, 1, 0};
+
+    // The row wraps its three items when narrow
+    ASSERT_TRUE(add_flow_breakpoint(&sys, row, 0, 200, {Direction::Horizontal, Align::Start}));
+    for (int i = 0; i < 3; i++) get_node(&sys, add_generic(&sys, row))->minimum_size = {80, 20};
+
+    get_node(&sys, root)->bounds = {{0, 0}, {300, 400}};
+    compute_layout(&sys, root);
+    ASSERT_EQ(get_active_type(&sys, row), NodeType::Generic);
+    ASSERT_NEAR(get_node(&sys, card)->bounds.size.y, 20, 0.01);
+
+    // One pass after the resize measures the row as the Flow it becomes
+    get_node(&sys, root)->bounds = {{0, 0}, {150, 400}};
+    compute_layout(&sys, root);
+    ASSERT_EQ(get_active_type(&sys, row), NodeType::Flow);
+    ASSERT_NEAR(get_node(&sys, row)->bounds.size.y, 60, 0.01);
+    ASSERT_NEAR(get_node(&sys, card)->bounds.size.y, 60, 0.01);
+}
+
+TEST(breakpoint_components_recycled_on_delete) {
+    System sys;
+    NodeId root = add_generic(&sys, NullNode);
+    ASSERT_TRUE(add_box_breakpoint(&sys, root, 0, 100, {Direction::Vertical, Align::Start}));
+    ASSERT_TRUE(add_margin_breakpoint(&sys, root, 100, 200, {1, 1, 1, 1}));
+
+    ASSERT_TRUE(delete_node(&sys, root));
+    ASSERT_EQ(sys.components.free_boxes.size(), 1);
+    ASSERT_EQ(sys.components.free_margins.size(), 1);
+    ASSERT_EQ(sys.components.free_breakpoints.size(), 1);
+}
+
+// ========== Mirroring Tests ==========
+
+// Row of two items in a margin, plus a right-anchored badge
+static NodeId build_mirror_tree(System* sys, NodeId* items, NodeId* badge) {
+    NodeId root = add_generic(sys, NullNode);
+    NodeId margin = add_margin(sys, root, {10, 0, 0, 0});
+    NodeId row = add_box(sys, margin, {Direction::Horizontal, Align::Start});
+    items[0] = add_generic(sys, row);
+    items[1] = add_generic(sys, row);
+    *badge = add_generic(sys, root);
+
+    get_node(sys, root)->bounds = {{0, 0}, {200, 100}};
+    get_node(sys, margin)->anchors = {0, 0, 1, 1};
+    get_node(sys, row)->expand = {1, 1};
+    get_node(sys, items[0])->minimum_size = {30, 10};
+    get_node(sys, items[1])->minimum_size = {40, 10};
+
+    Node* b = get_node(sys, *badge);
+    b->anchors = {1, 0, 1, 1};
+    b->offsets = {-20, 0, 5, 0};
+    return root;
+}
+
+TEST(mirror_x_solves_right_to_left) {
+    System sys;
+    NodeId items[2], badge;
+    NodeId root = build_mirror_tree(&sys, items, &badge);
+
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, items[0])->bounds.origin.x, 10, 0.01);
+    ASSERT_NEAR(get_node(&sys, items[1])->bounds.origin.x, 40, 0.01);
+    ASSERT_NEAR(get_node(&sys, badge)->bounds.origin.x, 180, 0.01);
+
+    get_node(&sys, root)->mirror_x = true;
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, items[0])->bounds.origin.x, 160, 0.01);
+    ASSERT_NEAR(get_node(&sys, items[1])->bounds.origin.x, 120, 0.01);
+    ASSERT_NEAR(get_node(&sys, badge)->bounds.origin.x, 5, 0.01);
+    ASSERT_NEAR(get_node(&sys, badge)->bounds.size.x, 15, 0.01);
+}
+
+TEST(set_mirror_x_matches_full_relayout) {
+    System sys;
+    NodeId items[2], badge;
+    NodeId root = build_mirror_tree(&sys, items, &badge);
+    compute_layout(&sys, root);
+
+    for (bool mirror : {true, false}) {
+        ASSERT_TRUE(set_mirror_x(&sys, root, mirror));
+
+        std::vector<Rect> reflected;
+        for (const Node& n : sys.nodes) reflected.push_back(n.bounds);
+
+        compute_layout(&sys, root);
+        for (size_t i = 0; i < sys.nodes.size(); i++) {
+            ASSERT_NEAR(sys.nodes[i].bounds.origin.x, reflected[i].origin.x, 0.01);
+            ASSERT_NEAR(sys.nodes[i].bounds.size.x, reflected[i].size.x, 0.01);
+        }
+    }
+    ASSERT_NEAR(get_node(&sys, items[0])->bounds.origin.x, 10, 0.01);
+}
+
+TEST(set_mirror_x_translates_mirrored_descendants) {
+    System sys;
+    NodeId items[2], badge;
+    NodeId root = build_mirror_tree(&sys, items, &badge);
+
+    // A group in the row that is right-to-left on its own, either way the root goes
+    NodeId row = get_node(&sys, items[0])->parent;
+    NodeId group = add_box(&sys, row, {Direction::Horizontal, Align::Start});
+    get_node(&sys, group)->minimum_size = {80, 10};
+    get_node(&sys, group)->mirror_x = true;
+    NodeId inner[2] = {add_generic(&sys, group), add_generic(&sys, group)};
+    get_node(&sys, inner[0])->minimum_size = {20, 10};
+    get_node(&sys, inner[1])->minimum_size = {30, 10};
+    compute_layout(&sys, root);
+
+    for (bool mirror : {true, false}) {
+        ASSERT_TRUE(set_mirror_x(&sys, root, mirror));
+
+        System reference = sys;
+        compute_layout(&reference, root);
+        for (size_t i = 0; i < sys.nodes.size(); i++) {
+            const Node &a = sys.nodes[i], &b = reference.nodes[i];
+            ASSERT_NEAR(a.bounds.origin.x, b.bounds.origin.x, 0.01);
+            ASSERT_NEAR(a.bounds.size.x, b.bounds.size.x, 0.01);
+            ASSERT_NEAR(a.content_extent.origin.x, b.content_extent.origin.x, 0.01);
+            ASSERT_NEAR(a.content_extent.size.x, b.content_extent.size.x, 0.01);
+        }
+    }
+
+    // Group after the items at 80, filled from its right edge
+    ASSERT_NEAR(get_node(&sys, inner[0])->bounds.origin.x, 140, 0.01);
+    ASSERT_NEAR(get_node(&sys, inner[1])->bounds.origin.x, 110, 0.01);
+}
+
+// ========== Stack Tests ==========
+
+TEST(stack_lays_out_only_active_page) {
+    System sys;
+    StackId stack = add_stack(&sys, NullNode);
+    NodeId pages[2], items[2];
+    for (int i = 0; i < 2; i++) {
+        pages[i] = add_box(&sys, stack, {Direction::Vertical, Align::Start});
+        add_generic(&sys, pages[i]);
+        items[i] = add_generic(&sys, pages[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        get_node(&sys, pages[i])->expand = {1, 1};
+        for (NodeId item : get_node(&sys, pages[i])->children)
+            get_node(&sys, item)->minimum_size = {10, 20};
+    }
+    get_node(&sys, stack)->bounds = {{0, 0}, {100, 100}};
+
+    compute_layout(&sys, stack);
+    ASSERT_EQ(get_active_type(&sys, stack), NodeType::Stack);
+    ASSERT_NEAR(get_node(&sys, pages[0])->bounds.size.x, 100, 0.01);
+    ASSERT_NEAR(get_node(&sys, items[0])->bounds.origin.y, 20, 0.01);
+    ASSERT_NEAR(get_node(&sys, items[1])->bounds.size.x, 0, 0.01);
+
+    ASSERT_TRUE(set_active_page(&sys, stack, 1));
+    compute_layout(&sys, stack);
+    ASSERT_NEAR(get_node(&sys, items[1])->bounds.origin.y, 20, 0.01);
+
+    // The hidden page keeps its results while the stack moves
+    get_node(&sys, stack)->bounds.origin = {50, 0};
+    compute_layout(&sys, stack);
+    ASSERT_NEAR(get_node(&sys, items[1])->bounds.origin.x, 50, 0.01);
+    ASSERT_NEAR(get_node(&sys, items[0])->bounds.origin.x, 0, 0.01);
+
+    // Its bounds changed, so it is solved again when shown
+    ASSERT_TRUE(set_active_page(&sys, stack, 0));
+    compute_layout(&sys, stack);
+    ASSERT_NEAR(get_node(&sys, items[0])->bounds.origin.x, 50, 0.01);
+
+    // A handle built from a node that isn't a Stack is refused, like a deleted one
+    ASSERT_FALSE(set_active_page(&sys, StackId{pages[0]}, 0));
+    ASSERT_TRUE(delete_node(&sys, stack));
+    ASSERT_FALSE(set_active_page(&sys, stack, 0));
+}
+
+TEST(stack_page_resolved_when_inputs_change) {
+    System sys;
+    StackId stack = add_stack(&sys, NullNode, {1});
+    NodeId page = add_box(&sys, stack, {Direction::Horizontal, Align::Start});
+    NodeId other = add_generic(&sys, stack);
+    NodeId a = add_generic(&sys, page);
+    NodeId b = add_generic(&sys, page);
+    get_node(&sys, stack)->bounds = {{0, 0}, {100, 100}};
+    get_node(&sys, page)->expand = {1, 1};
+    get_node(&sys, other)->expand = {1, 1};
+    get_node(&sys, a)->minimum_size = {30, 10};
+    get_node(&sys, b)->minimum_size = {30, 10};
+
+    set_active_page(&sys, stack, 0);
+    compute_layout(&sys, stack);
+    ASSERT_NEAR(get_node(&sys, b)->bounds.origin.x, 30, 0.01);
+
+    // Switching away and back without changes keeps the same results
+    set_active_page(&sys, stack, 1);
+    compute_layout(&sys, stack);
+    set_active_page(&sys, stack, 0);
+    compute_layout(&sys, stack);
+    ASSERT_NEAR(get_node(&sys, b)->bounds.origin.x, 30, 0.01);
+
+    // An input changed while the page was hidden
+    set_active_page(&sys, stack, 1);
+    compute_layout(&sys, stack);
+    get_node(&sys, a)->minimum_size = {45, 10};
+    set_active_page(&sys, stack, 0);
+    compute_layout(&sys, stack);
+    ASSERT_NEAR(get_node(&sys, b)->bounds.origin.x, 45, 0.01);
+}
+
+// ========== Masonry Tests ==========
+
+static NodeId add_card(System* sys, NodeId masonry, float height) {
+    NodeId card = add_generic(sys, masonry);
+    get_node(sys, card)->minimum_size = {0, height};
+    return card;
+}
+
+TEST(masonry_places_in_shortest_column) {
+    System sys;
+    NodeId masonry = add_masonry(&sys, NullNode, {3, 10});
+    get_node(&sys, masonry)->bounds = {{0, 0}, {320, 500}};
+    const float heights[] = {50, 30, 40, 20, 60};
+    NodeId cards[5];
+    for (int i = 0; i < 5; i++) cards[i] = add_card(&sys, masonry, heights[i]);
+
+    compute_layout(&sys, masonry);
+    // Columns are 100 wide, the fourth card goes under the 30, the fifth under the 40
+    ASSERT_NEAR(get_node(&sys, cards[1])->bounds.origin.x, 110, 0.01);
+    ASSERT_NEAR(get_node(&sys, cards[1])->bounds.size.x, 100, 0.01);
+    ASSERT_NEAR(get_node(&sys, cards[3])->bounds.origin.x, 110, 0.01);
+    ASSERT_NEAR(get_node(&sys, cards[3])->bounds.origin.y, 40, 0.01);
+    ASSERT_NEAR(get_node(&sys, cards[4])->bounds.origin.x, 220, 0.01);
+    ASSERT_NEAR(get_node(&sys, cards[4])->bounds.origin.y, 50, 0.01);
+}
+
+TEST(masonry_resumes_after_append) {
+    System appended, rebuilt;
+    NodeId a = add_masonry(&appended, NullNode, {4, 5});
+    NodeId b = add_masonry(&rebuilt, NullNode, {4, 5});
+    get_node(&appended, a)->bounds = {{0, 0}, {400, 800}};
+    get_node(&rebuilt, b)->bounds = {{0, 0}, {400, 800}};
+
+    for (int i = 0; i < 10; i++) add_card(&appended, a, 20.f + (i * 37 % 50));
+    compute_layout(&appended, a);
+    for (int i = 10; i < 25; i++) add_card(&appended, a, 20.f + (i * 37 % 50));
+    compute_layout(&appended, a);
+
+    for (int i = 0; i < 25; i++) add_card(&rebuilt, b, 20.f + (i * 37 % 50));
+    compute_layout(&rebuilt, b);
+
+    for (size_t i = 0; i < appended.nodes.size(); i++) {
+        ASSERT_NEAR(appended.nodes[i].bounds.origin.x, rebuilt.nodes[i].bounds.origin.x, 0.01);
+        ASSERT_NEAR(appended.nodes[i].bounds.origin.y, rebuilt.nodes[i].bounds.origin.y, 0.01);
+    }
+
+    // Changing an earlier card places everything again once invalidated
+    NodeId first = get_node(&appended, a)->children[0];
+    get_node(&appended, first)->minimum_size.y += 100;
+    invalidate_layout(&appended, first);
+    compute_layout(&appended, a);
+
+    System fresh;
+    NodeId c = add_masonry(&fresh, NullNode, {4, 5});
+    get_node(&fresh, c)->bounds = {{0, 0}, {400, 800}};
+    for (int i = 0; i < 25; i++) add_card(&fresh, c, 20.f + (i * 37 % 50) + (i == 0 ? 100.f : 0.f));
+    compute_layout(&fresh, c);
+    for (size_t i = 0; i < appended.nodes.size(); i++)
+        ASSERT_NEAR(appended.nodes[i].bounds.origin.y, fresh.nodes[i].bounds.origin.y, 0.01);
+    ASSERT_NEAR(get_node(&appended, get_node(&appended, a)->children[1])->bounds.origin.y, 0, 0.01);
+}
+
+// Bounds of every node with fast paths off, from the same inputs
+static bool matches_plain_layout(const System &sys, NodeId root) {
+    System reference = sys;
+    reference.fast_paths = false;
+    compute_layout(&reference, root);
+    for (size_t i = 0; i < sys.nodes.size(); i++) {
+        const Rect &a = sys.nodes[i].bounds, &b = reference.nodes[i].bounds;
+        if (a.origin.x != b.origin.x || a.origin.y != b.origin.y || a.size.x != b.size.x || a.size.y != b.size.y)
+            return false;
+    }
+    return true;
+}
+
+TEST(masonry_restarts_when_placed_heights_change) {
+    System sys;
+    NodeId masonry = add_masonry(&sys, NullNode, {2, 0});
+    get_node(&sys, masonry)->bounds = {{0, 0}, {200, 400}};
+    NodeId a = add_flow(&sys, masonry, {Direction::Horizontal, Align::Start});
+    get_node(&sys, add_generic(&sys, a))->minimum_size = {40, 50};
+    NodeId item = add_generic(&sys, a);
+    get_node(&sys, item)->minimum_size = {40, 50};
+    NodeId cards[2] = {add_card(&sys, masonry, 50), add_card(&sys, masonry, 30)};
+    compute_layout(&sys, masonry);
+    ASSERT_NEAR(get_node(&sys, a)->bounds.size.y, 50, 0.01);
+
+    // The item wraps to a second line: invalidating it resets its Flow and the Masonry above
+    get_node(&sys, item)->minimum_size = {80, 50};
+    invalidate_layout(&sys, item);
+    add_card(&sys, masonry, 20);
+    compute_layout(&sys, masonry);
+    ASSERT_NEAR(get_node(&sys, a)->bounds.size.y, 100, 0.01);
+    ASSERT_TRUE(matches_plain_layout(sys, masonry));
+
+    // An earlier card changed
+    get_node(&sys, cards[0])->minimum_size.y = 200;
+    invalidate_layout(&sys, cards[0]);
+    add_card(&sys, masonry, 10);
+    compute_layout(&sys, masonry);
+    ASSERT_NEAR(get_node(&sys, cards[0])->bounds.size.y, 200, 0.01);
+    ASSERT_TRUE(matches_plain_layout(sys, masonry));
+
+    // Unchanged heights still resume: appending places one more child
+    const MasonryState &state = sys.components.masonry_states[get_node(&sys, masonry)->component_index];
+    add_card(&sys, masonry, 15);
+    compute_layout(&sys, masonry);
+    ASSERT_EQ(state.placed, 6u);
+    ASSERT_EQ(state.heights.size(), 6u);
+    ASSERT_TRUE(matches_plain_layout(sys, masonry));
+}
+
+TEST(masonry_append_skips_placed_children) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    get_node(&sys, root)->bounds = {{0, 0}, {200, 1000}};
+    NodeId masonry = add_masonry(&sys, root, {2, 0});
+    NodeId flows[4];
+    for (NodeId &flow: flows) {
+        flow = add_flow(&sys, masonry, {Direction::Horizontal, Align::Start});
+        for (int i = 0; i < 3; i++) get_node(&sys, add_generic(&sys, flow))->minimum_size = {40, 20};
+    }
+    compute_layout(&sys, root);
+    const float height = get_node(&sys, masonry)->bounds.size.y;
+
+    // The Masonry grows, only the new card is measured and the placed ones keep their bounds
+    NodeId card = add_card(&sys, masonry, 100);
+    const Rect bounds = get_bounds(&sys, card);
+    ASSERT_NEAR(get_node(&sys, masonry)->bounds.size.y, height + 100, 0.01);
+    for (NodeId flow: flows) ASSERT_TRUE(sys.measured[flow.index].pass != sys.layout_pass);
+    const MasonryState &state = sys.components.masonry_states[get_node(&sys, masonry)->component_index];
+    ASSERT_EQ(state.placed, 5u);
+    ASSERT_TRUE(matches_plain_layout(sys, root));
+    ASSERT_NEAR(bounds.origin.y, get_node(&sys, card)->bounds.origin.y, 0.01);
+
+    // Moving the Masonry places the children from their stored heights
+    get_node(&sys, root)->bounds.origin = {0, 50};
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_node(&sys, flows[0])->bounds.origin.y, 50, 0.01);
+    for (NodeId flow: flows) ASSERT_TRUE(sys.measured[flow.index].pass != sys.layout_pass);
+    ASSERT_TRUE(matches_plain_layout(sys, root));
+}
+
+// ========== Anchor Target Tests ==========
+
+TEST(anchor_target_in_other_root) {
+    System sys;
+    // The overlay is created first, so it has to wait for the main root
+    NodeId overlay = add_generic(&sys, NullNode);
+    NodeId tooltip = add_generic(&sys, overlay);
+    NodeId main = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    add_generic(&sys, main);
+    NodeId button = add_generic(&sys, main);
+
+    get_node(&sys, overlay)->bounds = {{0, 0}, {400, 300}};
+    get_node(&sys, main)->bounds = {{10, 20}, {400, 30}};
+    for (NodeId child : get_node(&sys, main)->children)
+        get_node(&sys, child)->minimum_size = {100, 30};
+
+    // Below the button, as wide as the button
+    Node* t = get_node(&sys, tooltip);
+    t->anchors = {0, 1, 1, 1};
+    t->offsets = {0, 5, 0, -25};
+    ASSERT_TRUE(set_anchor_target(&sys, tooltip, button));
+
+    ASSERT_TRUE(compute_layout_all(&sys));
+    Rect r = get_node(&sys, tooltip)->bounds;
+    ASSERT_NEAR(r.origin.x, 110, 0.01);
+    ASSERT_NEAR(r.origin.y, 55, 0.01);
+    ASSERT_NEAR(r.size.x, 100, 0.01);
+    ASSERT_NEAR(r.size.y, 20, 0.01);
+}
+
+TEST(anchor_target_cycle_detected) {
+    System sys;
+    NodeId a = add_generic(&sys, NullNode);
+    NodeId b = add_generic(&sys, NullNode);
+    NodeId a_child = add_generic(&sys, a);
+    NodeId b_child = add_generic(&sys, b);
+    NodeId free_root = add_generic(&sys, NullNode);
+    NodeId free_child = add_generic(&sys, free_root);
+
+    ASSERT_TRUE(set_anchor_target(&sys, a_child, b_child));
+    ASSERT_TRUE(set_anchor_target(&sys, b_child, a_child));
+    ASSERT_FALSE(set_anchor_target(&sys, a_child, a_child));
+
+    get_node(&sys, free_root)->bounds = {{0, 0}, {50, 50}};
+    get_node(&sys, free_child)->anchors = {0, 0, 1, 1};
+    ASSERT_FALSE(compute_layout_all(&sys));
+
+    // Roots outside the cycle are still laid out
+    ASSERT_NEAR(get_node(&sys, free_child)->bounds.size.x, 50, 0.01);
+
+    ASSERT_TRUE(set_anchor_target(&sys, b_child, NullNode));
+    ASSERT_TRUE(compute_layout_all(&sys));
+}
+
+// ========== Shared Layout Tests ==========
+
+// A vertical list of rows, each an icon and an expanding label
+static NodeId build_list(System* sys, bool share, NodeId* labels, int rows) {
+    NodeId list = add_box(sys, NullNode, {Direction::Vertical, Align::Start});
+    for (int i = 0; i < rows; i++) {
+        NodeId row = add_box(sys, list, {Direction::Horizontal, Align::Start});
+        NodeId icon = add_generic(sys, row);
+        labels[i] = add_generic(sys, row);
+        get_node(sys, row)->minimum_size = {200, 20};
+        get_node(sys, icon)->minimum_size = {20, 20};
+        get_node(sys, labels[i])->minimum_size = {50, 20};
+        get_node(sys, labels[i])->expand = {1, 0};
+    }
+    get_node(sys, list)->bounds = {{5, 5}, {200, 400}};
+    set_share_layouts(sys, list, share);
+    return list;
+}
+
+TEST(shared_rows_match_solved_rows) {
+    const int rows = 6;
+    System solved, shared;
+    NodeId labels[rows];
+    NodeId a = build_list(&solved, false, labels, rows);
+    NodeId b = build_list(&shared, true, labels, rows);
+
+    // One row differs and has to be solved on its own
+    get_node(&solved, labels[3])->minimum_size = {50, 30};
+    get_node(&shared, labels[3])->minimum_size = {50, 30};
+
+    for (int pass = 0; pass < 2; pass++) {
+        compute_layout(&solved, a);
+        compute_layout(&shared, b);
+        for (size_t i = 0; i < solved.nodes.size(); i++) {
+            ASSERT_NEAR(shared.nodes[i].bounds.origin.x, solved.nodes[i].bounds.origin.x, 0.01);
+            ASSERT_NEAR(shared.nodes[i].bounds.origin.y, solved.nodes[i].bounds.origin.y, 0.01);
+            ASSERT_NEAR(shared.nodes[i].bounds.size.x, solved.nodes[i].bounds.size.x, 0.01);
+            ASSERT_NEAR(shared.nodes[i].bounds.size.y, solved.nodes[i].bounds.size.y, 0.01);
+        }
+    }
+
+    ASSERT_NEAR(get_node(&shared, labels[5])->bounds.origin.x, 25, 0.01);
+    ASSERT_NEAR(get_node(&shared, labels[5])->bounds.origin.y, 105, 0.01);
+    ASSERT_NEAR(get_node(&shared, labels[5])->bounds.size.x, 180, 0.01);
+    ASSERT_NEAR(get_node(&shared, labels[3])->bounds.size.y, 30, 0.01);
+}
+
+TEST(shared_layouts_keep_host_placed_children) {
+    System sys;
+    NodeId list = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId rows[2], dots[2];
+    for (int i = 0; i < 2; i++) {
+        rows[i] = add_generic(&sys, list);
+        dots[i] = add_generic(&sys, rows[i]);
+    }
+    get_node(&sys, list)->bounds = {{0, 0}, {100, 100}};
+    set_share_layouts(&sys, list, true);
+    for (int i = 0; i < 2; i++) {
+        get_node(&sys, rows[i])->minimum_size = {100, 20};
+        get_node(&sys, dots[i])->minimum_size = {4, 4};
+    }
+
+    // The host places the dots, their origins must not be copied between rows
+    get_node(&sys, dots[0])->bounds.origin = {10, 10};
+    get_node(&sys, dots[1])->bounds.origin = {70, 30};
+    compute_layout(&sys, list);
+
+    ASSERT_NEAR(get_node(&sys, dots[1])->bounds.origin.x, 70, 0.01);
+    ASSERT_NEAR(get_node(&sys, dots[1])->bounds.origin.y, 30, 0.01);
+}
+
+TEST(nested_shared_lists_match_plain_layout) {
+    System sys;
+    NodeId outer = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    get_node(&sys, outer)->bounds = {{0, 0}, {200, 400}};
+    set_share_layouts(&sys, outer, true);
+
+    // Sections are lists of their own, the second one has a taller row so it isn't copied
+    for (int s = 0; s < 3; s++) {
+        NodeId section = add_box(&sys, outer, {Direction::Vertical, Align::Start});
+        get_node(&sys, section)->minimum_size = {200, s == 1 ? 90.f : 80.f};
+        get_node(&sys, section)->expand = {1, 0};
+        set_share_layouts(&sys, section, true);
+        for (int r = 0; r < 4; r++) {
+            NodeId row = add_box(&sys, section, {Direction::Horizontal, Align::Start});
+            NodeId icon = add_generic(&sys, row);
+            NodeId label = add_generic(&sys, row);
+            get_node(&sys, row)->minimum_size = {200, s == 1 && r == 2 ? 30.f : 20.f};
+            get_node(&sys, row)->expand = {1, 0};
+            get_node(&sys, icon)->minimum_size = {20, 20};
+            get_node(&sys, label)->minimum_size = {50, 20};
+            get_node(&sys, label)->expand = {1, 0};
+        }
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        compute_layout(&sys, outer);
+        ASSERT_TRUE(matches_plain_layout(sys, outer));
+    }
+    const Node &last_section = sys.nodes[get_node(&sys, outer)->children[2].index];
+    const Node &last_row = sys.nodes[last_section.children[3].index];
+    ASSERT_NEAR(last_section.bounds.origin.y, 170, 0.01);
+    ASSERT_NEAR(last_row.bounds.origin.y, 230, 0.01);
+    ASSERT_NEAR(sys.nodes[last_row.children[1].index].bounds.size.x, 180, 0.01);
+}
+
+// ========== Shadow Validation Tests ==========
+
+TEST(shadow_validation_agrees_with_fast_paths) {
+    System sys;
+    NodeId labels[8];
+    NodeId list = build_list(&sys, true, labels, 8);
+
+    ShadowValidator validator;
+    validator.sample_rate = 1.f;
+    int reported = 0;
+    validator.on_mismatch = [&](const ShadowMismatch&) { reported++; };
+
+    for (int frame = 0; frame < 3; frame++)
+        ASSERT_TRUE(compute_layout_validated(&sys, list, &validator));
+    ASSERT_EQ(validator.sampled, 3u);
+    ASSERT_EQ(validator.mismatches, 0u);
+    ASSERT_EQ(reported, 0);
+
+    validator.sample_rate = 0.f;
+    ASSERT_FALSE(compute_layout_validated(&sys, list, &validator));
+    ASSERT_EQ(validator.frames, 4u);
+}
+
+TEST(shadow_validation_reports_stale_fast_path) {
+    System sys;
+    NodeId masonry = add_masonry(&sys, NullNode, {2, 0});
+    get_node(&sys, masonry)->bounds = {{0, 0}, {200, 400}};
+    NodeId cards[3];
+    for (int i = 0; i < 3; i++) cards[i] = add_card(&sys, masonry, 50);
+    compute_layout(&sys, masonry);
+
+    // A bug in the stored placement, resuming from it puts the appended card too low
+    MasonryState &state = sys.components.masonry_states[get_node(&sys, masonry)->component_index];
+    for (auto &column: state.columns) column.first += 100;
+    NodeId appended = add_card(&sys, masonry, 50);
+
+    ShadowValidator validator;
+    validator.sample_rate = 1.f;
+    std::vector<ShadowMismatch> reported;
+    std::vector<Rect> live;
+    validator.on_mismatch = [&](const ShadowMismatch& m) {
+        reported.push_back(m);
+        live.push_back(get_node(&sys, m.node)->bounds);
+    };
+    compute_layout_validated(&sys, masonry, &validator);
+
+    ASSERT_FALSE(reported.empty());
+    ASSERT_TRUE(reported[0].node == appended);
+    ASSERT_NEAR(live[0].origin.y, 150, 0.01); // The reference results never reach the live nodes
+    ASSERT_NEAR(reported[0].active.origin.y, 150, 0.01);
+    ASSERT_NEAR(reported[0].reference.origin.y, 50, 0.01);
+
+    // The live bounds are the ones the active path produced
+    ASSERT_NEAR(get_node(&sys, appended)->bounds.origin.y, 150, 0.01);
+    ASSERT_NEAR(get_node(&sys, cards[0])->bounds.size.y, 50, 0.01);
+}
+
+TEST(shadow_validation_compares_content_extents) {
+    System sys;
+    StackId stack = add_stack(&sys, NullNode);
+    NodeId page = add_box(&sys, stack, {Direction::Vertical, Align::Start});
+    for (int i = 0; i < 2; i++) get_node(&sys, add_generic(&sys, page))->minimum_size = {10, 20};
+    get_node(&sys, page)->expand = {1, 1};
+    get_node(&sys, stack)->bounds = {{0, 0}, {100, 100}};
+    compute_layout(&sys, stack);
+    const Rect extent = get_node(&sys, page)->content_extent;
+    ASSERT_NEAR(extent.size.y, 40, 0.01);
+
+    // A stale extent on a page that is skipped, its bounds and its children's are right
+    get_node(&sys, page)->content_extent = {{0, 0}, {100, 500}};
+    get_node(&sys, page)->overflow = true;
+
+    ShadowValidator validator;
+    validator.sample_rate = 1.f;
+    std::vector<ShadowMismatch> reported;
+    validator.on_mismatch = [&](const ShadowMismatch& m) { reported.push_back(m); };
+    compute_layout_validated(&sys, stack, &validator);
+
+    ASSERT_EQ(reported.size(), 1u);
+    ASSERT_TRUE(reported[0].node == page);
+    ASSERT_NEAR(reported[0].active.size.y, reported[0].reference.size.y, 0.01);
+    ASSERT_NEAR(reported[0].active_extent.size.y, 500, 0.01);
+    ASSERT_NEAR(reported[0].reference_extent.size.y, extent.size.y, 0.01);
+
+    // The active extent is left in place, not the reference one
+    ASSERT_NEAR(get_node(&sys, page)->content_extent.size.y, 500, 0.01);
+    ASSERT_TRUE(get_node(&sys, page)->overflow);
+}
+
+// ========== History Tests ==========
+
+TEST(history_reconstructs_recorded_frames) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId a = add_generic(&sys, root);
+    get_node(&sys, root)->bounds = {{0, 0}, {100, 50}};
+    get_node(&sys, a)->minimum_size = {10, 10};
+
+    LayoutRecorder recorder;
+    init_recorder(&recorder, 3);
+    std::vector<std::vector<Rect> > expected;
+
+    for (int frame = 0; frame < 5; frame++) {
+        if (frame == 2) add_generic(&sys, root);
+        get_node(&sys, a)->minimum_size.x += 5;
+        compute_layout(&sys, root);
+        ASSERT_EQ(record_frame(&recorder, &sys), static_cast<uint64_t>(frame));
+
+        expected.emplace_back();
+        for (const Node& n : sys.nodes) expected.back().push_back(n.bounds);
+    }
+
+    std::vector<Rect> bounds;
+    ASSERT_FALSE(reconstruct_frame(&recorder, 1, &bounds));
+    ASSERT_FALSE(reconstruct_frame(&recorder, 5, &bounds));
+    for (uint64_t frame = 2; frame < 5; frame++) {
+        ASSERT_TRUE(reconstruct_frame(&recorder, frame, &bounds));
+        ASSERT_EQ(bounds.size(), expected[frame].size());
+        for (size_t i = 0; i < bounds.size(); i++) {
+            ASSERT_NEAR(bounds[i].origin.x, expected[frame][i].origin.x, 1e-6);
+            ASSERT_NEAR(bounds[i].size.x, expected[frame][i].size.x, 1e-6);
+        }
+    }
+
+    // Only the growing child and the one after it changed in the last frame
+    ASSERT_EQ(recorder.frames[recorder.newest].changes.size(), 2u);
+
+    // A recorder that was never initialized has no ring to record into
+    LayoutRecorder empty;
+    ASSERT_EQ(record_frame(&empty, &sys), NoFrame);
+    ASSERT_FALSE(reconstruct_frame(&empty, 0, &bounds));
+}
+
+// ========== Lazy Evaluation Tests ==========
+
+TEST(get_bounds_solves_only_the_path) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId left = add_box(&sys, root, {Direction::Vertical, Align::Start});
+    NodeId right = add_box(&sys, root, {Direction::Vertical, Align::Start});
+    NodeId left_item = add_generic(&sys, left);
+    NodeId right_item1 = add_generic(&sys, right);
+    NodeId right_item2 = add_generic(&sys, right);
+
+    get_node(&sys, root)->bounds = {{0, 0}, {200, 100}};
+    get_node(&sys, left)->minimum_size = {100, 100};
+    get_node(&sys, right)->minimum_size = {100, 100};
+    get_node(&sys, left_item)->minimum_size = {10, 10};
+    get_node(&sys, right_item1)->minimum_size = {10, 10};
+    get_node(&sys, right_item2)->minimum_size = {10, 10};
+
+    Rect r = get_bounds(&sys, right_item2);
+    ASSERT_NEAR(r.origin.x, 100, 0.01);
+    ASSERT_NEAR(r.origin.y, 10, 0.01);
+
+    // The left column was never needed
+    ASSERT_FALSE(get_node(&sys, left)->layout_clean);
+    ASSERT_TRUE(get_node(&sys, right)->layout_clean);
+
+    // Growing the first item only moves its sibling once queried
+    get_node(&sys, right_item1)->minimum_size = {10, 30};
+    invalidate_layout(&sys, right_item1);
+    ASSERT_NEAR(get_node(&sys, right_item2)->bounds.origin.y, 10, 0.01);
+    ASSERT_NEAR(get_bounds(&sys, right_item2).origin.y, 30, 0.01);
+
+    ASSERT_NEAR(get_bounds(&sys, left_item).origin.x, 0, 0.01);
+}
+
+// Card around a wrapping row of four items, and a footer below it
+static NodeId build_wrapping_card(System *sys, NodeId *item, NodeId *footer) {
+    NodeId root = add_box(sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId card = add_generic(sys, root);
+    NodeId row = add_flow(sys, card, {Direction::Horizontal, Align::Start});
+    *footer = add_generic(sys, root);
+    get_node(sys, card)->anchors = {0, 0, 1, 0};
+    get_node(sys, row)->anchors = {0, 0, 1, 0};
+    get_node(sys, *footer)->minimum_size = {10, 10};
+    for (int i = 0; i < 4; i++) {
+        NodeId added = add_generic(sys, row);
+        get_node(sys, added)->minimum_size = {100, 20};
+        if (i == 0) *item = added;
+    }
+    get_node(sys, root)->bounds = {{0, 0}, {300, 400}};
+    return root;
+}
+
+TEST(get_bounds_after_deep_wrapping_change) {
+    System lazy, eager;
+    NodeId lazy_item, lazy_footer, eager_item, eager_footer;
+    build_wrapping_card(&lazy, &lazy_item, &lazy_footer);
+    NodeId eager_root = build_wrapping_card(&eager, &eager_item, &eager_footer);
+
+    // A line of three items and one of one
+    ASSERT_NEAR(get_bounds(&lazy, lazy_footer).origin.y, 40, 0.01);
+
+    // A taller item makes the card taller, three levels up
+    get_node(&lazy, lazy_item)->minimum_size = {100, 60};
+    invalidate_layout(&lazy, lazy_item);
+    get_node(&eager, eager_item)->minimum_size = {100, 60};
+    compute_layout(&eager, eager_root);
+
+    ASSERT_NEAR(get_node(&eager, eager_footer)->bounds.origin.y, 80, 0.01);
+    ASSERT_NEAR(get_bounds(&lazy, lazy_footer).origin.y, 80, 0.01);
+
+    // So does a taller item on the second line, without an explicit invalidation
+    NodeId row = get_node(&lazy, lazy_item)->parent;
+    get_node(&lazy, add_generic(&lazy, row))->minimum_size = {100, 50};
+    ASSERT_NEAR(get_bounds(&lazy, lazy_footer).origin.y, 110, 0.01);
+}
+
+TEST(get_bounds_after_structure_change) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId first = add_generic(&sys, root);
+    NodeId second = add_generic(&sys, root);
+
+    get_node(&sys, root)->bounds = {{0, 0}, {200, 100}};
+    get_node(&sys, first)->minimum_size = {50, 10};
+    get_node(&sys, second)->minimum_size = {50, 10};
+
+    compute_layout(&sys, root);
+    ASSERT_NEAR(get_bounds(&sys, second).origin.x, 50, 0.01);
+
+    delete_node(&sys, first);
+    ASSERT_NEAR(get_bounds(&sys, second).origin.x, 0, 0.01);
+
+    // Moving the root only needs an invalidation
+    get_node(&sys, root)->bounds.origin = {10, 0};
+    invalidate_layout(&sys, root);
+    ASSERT_NEAR(get_bounds(&sys, second).origin.x, 10, 0.01);
+}
+
+TEST(get_bounds_follows_anchor_targets) {
+    System sys;
+    NodeId overlay = add_generic(&sys, NullNode);
+    NodeId tooltip = add_generic(&sys, overlay);
+    NodeId main = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId first = add_generic(&sys, main);
+    NodeId button = add_generic(&sys, main);
+    get_node(&sys, overlay)->bounds = {{0, 0}, {400, 300}};
+    get_node(&sys, main)->bounds = {{10, 20}, {400, 30}};
+    get_node(&sys, first)->minimum_size = {100, 30};
+    get_node(&sys, button)->minimum_size = {100, 30};
+    get_node(&sys, tooltip)->anchors = {0, 1, 1, 1};
+    get_node(&sys, tooltip)->offsets = {0, 5, 0, -25};
+    ASSERT_TRUE(set_anchor_target(&sys, tooltip, button));
+    ASSERT_TRUE(compute_layout_all(&sys));
+    ASSERT_NEAR(get_bounds(&sys, tooltip).origin.x, 110, 0.01);
+
+    // Only the target's parent is invalidated, the tooltip is in another tree
+    get_node(&sys, first)->minimum_size = {150, 30};
+    invalidate_layout(&sys, first);
+    ASSERT_NEAR(get_bounds(&sys, tooltip).origin.x, 160, 0.01);
+
+    // Asking for the tooltip first still places the button before it
+    get_node(&sys, first)->minimum_size = {50, 30};
+    invalidate_layout(&sys, first);
+    invalidate_layout(&sys, tooltip);
+    ASSERT_NEAR(get_bounds(&sys, tooltip).origin.x, 60, 0.01);
+
+    // One link per dependent, replaced when the target changes
+    ASSERT_EQ(sys.anchor_links.size(), 1u);
+    ASSERT_TRUE(set_anchor_target(&sys, tooltip, first));
+    ASSERT_EQ(sys.anchor_links.size(), 1u);
+    ASSERT_TRUE(set_anchor_target(&sys, tooltip, NullNode));
+    ASSERT_TRUE(sys.anchor_links.empty());
+    ASSERT_TRUE(set_anchor_target(&sys, tooltip, first));
+    delete_node(&sys, overlay);
+    ASSERT_TRUE(sys.anchor_links.empty());
+}
+
+TEST(get_bounds_after_deleting_anchor_target) {
+    System sys;
+    NodeId overlay = add_generic(&sys, NullNode);
+    NodeId tooltip = add_generic(&sys, overlay);
+    NodeId main = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    NodeId first = add_generic(&sys, main);
+    NodeId button = add_generic(&sys, main);
+    NodeId sidebar = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    NodeId item = add_generic(&sys, sidebar);
+    get_node(&sys, overlay)->bounds = {{0, 0}, {400, 300}};
+    get_node(&sys, main)->bounds = {{10, 20}, {400, 30}};
+    get_node(&sys, sidebar)->bounds = {{0, 0}, {100, 300}};
+    get_node(&sys, first)->minimum_size = {100, 30};
+    get_node(&sys, button)->minimum_size = {100, 30};
+    get_node(&sys, item)->minimum_size = {50, 20};
+    get_node(&sys, tooltip)->anchors = {0, 1, 1, 1};
+    get_node(&sys, tooltip)->offsets = {0, 5, 0, -25};
+    ASSERT_TRUE(set_anchor_target(&sys, tooltip, button));
+    ASSERT_NEAR(get_bounds(&sys, tooltip).origin.x, 110, 0.01);
+
+    // The tooltip falls back to its parent, the sidebar doesn't feed it and stays dirty
+    ASSERT_TRUE(delete_node(&sys, button));
+    ASSERT_TRUE(get_node(&sys, tooltip)->anchor_target.is_null());
+    ASSERT_TRUE(sys.anchor_links.empty());
+    ASSERT_FALSE(get_node(&sys, overlay)->layout_clean);
+    const Rect bounds = get_bounds(&sys, tooltip);
+    ASSERT_FALSE(get_node(&sys, sidebar)->layout_clean);
+
+    compute_layout(&sys, overlay);
+    const Rect expected = get_node(&sys, tooltip)->bounds;
+    ASSERT_NEAR(bounds.origin.x, expected.origin.x, 0.01);
+    ASSERT_NEAR(bounds.origin.y, expected.origin.y, 0.01);
+    ASSERT_NEAR(bounds.size.x, expected.size.x, 0.01);
+    ASSERT_NEAR(bounds.size.y, expected.size.y, 0.01);
+}
+
+// ========== Layout Tape Tests ==========
+
+// The same tree in each System: a mirror tree with a Stack, a responsive Box and a Flow of leaves
+static NodeId build_tape_tree(System* sys, NodeId* items, NodeId* list) {
+    NodeId badge;
+    NodeId root = build_mirror_tree(sys, items, &badge);
+    StackId stack = add_stack(sys, root);
+    get_node(sys, stack)->anchors = {0, 0, 1, 1};
+    get_node(sys, add_generic(sys, stack))->minimum_size = {5, 5};
+
+    *list = add_box(sys, root, {Direction::Vertical, Align::Start});
+    get_node(sys, *list)->anchors = {0, 0, 1, 1};
+    add_box_breakpoint(sys, *list, 0, 150, {Direction::Horizontal, Align::Start});
+    NodeId flow = add_flow(sys, *list, {Direction::Horizontal, Align::Start});
+    for (int i = 0; i < 4; i++) get_node(sys, add_generic(sys, flow))->minimum_size = {60, 10};
+    get_node(sys, add_generic(sys, *list))->minimum_size = {20, 300}; // Overflows the root
+    return root;
+}
+
+static bool same_layout(const System& a, const System& b) {
+    if (a.nodes.size() != b.nodes.size()) return false;
+    for (size_t i = 0; i < a.nodes.size(); i++) {
+        const Node &x = a.nodes[i], &y = b.nodes[i];
+        if (x.bounds.origin.x != y.bounds.origin.x || x.bounds.origin.y != y.bounds.origin.y ||
+            x.bounds.size.x != y.bounds.size.x || x.bounds.size.y != y.bounds.size.y)
+            return false;
+        const Rect &e = x.content_extent, &f = y.content_extent;
+        if (e.origin.x != f.origin.x || e.origin.y != f.origin.y || e.size.x != f.size.x || e.size.y != f.size.y ||
+            x.overflow != y.overflow)
+            return false;
+    }
+    return true;
+}
+
+TEST(tape_matches_compute_layout) {
+    System taped, solved;
+    NodeId items[2], list;
+    NodeId a = build_tape_tree(&taped, items, &list);
+    NodeId b = build_tape_tree(&solved, items, &list);
+
+    LayoutTape tape;
+    ASSERT_TRUE(compile_layout(&taped, a, &tape));
+    // Leaves don't get an op, the Stack's page is left to the recursive pass
+    ASSERT_EQ(tape.ops.size(), 6u);
+    ASSERT_EQ(tape.leaves.size(), 8u);
+
+    for (int frame = 0; frame < 6; frame++) {
+        size_t ops = tape.ops.size();
+        for (System* sys : {&taped, &solved}) {
+            NodeId root = sys == &taped ? a : b;
+            if (frame == 1) set_mirror_x(sys, root, true);
+            if (frame == 2) get_node(sys, root)->bounds.size.x = 120; // The list switches to its breakpoint
+            if (frame == 3) get_node(sys, add_box(sys, items[1], {Direction::Vertical, Align::Start}))->minimum_size = {8, 8};
+            if (frame == 4) delete_node(sys, get_node(sys, list)->children[0]);
+            if (frame == 5) reparent_node(sys, items[0], list);
+        }
+        run_layout_tape(&taped, &tape);
+        compute_layout(&solved, b);
+        ASSERT_TRUE(same_layout(taped, solved));
+        ASSERT_EQ(tape.structure_version, taped.structure_version);
+
+        // Structure changes recompile the tape on the next run
+        if (frame == 3) ASSERT_EQ(tape.ops.size(), ops + 2); // The item stops being a leaf
+        if (frame == 4) ASSERT_EQ(tape.ops.size(), ops - 1);
+        if (frame == 4) ASSERT_EQ(tape.leaves.size(), 3u);
+        if (frame == 5) ASSERT_EQ(tape.leaves.back(), items[0].index);
+    }
+}
+
+// ========== Streaming Tests ==========
+
+TEST(streaming_publishes_final_subtrees_in_order) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Vertical, Align::Start});
+    get_node(&sys, root)->bounds = {{0, 0}, {400, 800}};
+
+    std::vector<NodeId> panels;
+    for (int i = 0; i < 8; i++) {
+        NodeId panel = add_box(&sys, root, {Direction::Horizontal, Align::Start});
+        get_node(&sys, panel)->minimum_size = {400, 100};
+        for (int j = 0; j < 20; j++)
+            get_node(&sys, add_generic(&sys, panel))->minimum_size = {10, 10};
+        panels.push_back(panel);
+    }
+
+    LayoutStream stream;
+    init_stream(&stream, 2);  // Smaller than the panel count to exercise back-pressure
+
+    std::vector<NodeId> received;
+    std::vector<float> last_child_x;
+    std::thread consumer([&] {
+        NodeId id;
+        while (stream_wait_pop(&stream, &id)) {
+            const Node* panel = get_node(&sys, id);
+            received.push_back(id);
+            last_child_x.push_back(get_node(&sys, panel->children.back())->bounds.origin.x);
+        }
+    });
+
+    compute_layout_streaming(&sys, root, &stream);
+    consumer.join();
+
+    ASSERT_EQ(received.size(), panels.size());
+    for (size_t i = 0; i < panels.size(); i++) {
+        ASSERT_EQ(received[i], panels[i]);
+        ASSERT_NEAR(last_child_x[i], 190, 0.01);
+    }
+}
+
+// ========== Compact Input Tests ==========
+
+TEST(half_conversion_rounds_to_nearest_even) {
+    ASSERT_EQ(half_bits_to_float(float_to_half_bits(1024.f)), 1024.f);
+    ASSERT_EQ(half_bits_to_float(float_to_half_bits(0.25f)), 0.25f);
+    ASSERT_EQ(half_bits_to_float(float_to_half_bits(-3.5f)), -3.5f);
+    ASSERT_EQ(half_bits_to_float(float_to_half_bits(65504.f)), 65504.f);
+    ASSERT_TRUE(std::isinf(half_bits_to_float(float_to_half_bits(65520.f))));
+
+    // Above 2048 the spacing is 2, ties go to the even mantissa
+    ASSERT_EQ(half_bits_to_float(float_to_half_bits(2049.f)), 2048.f);
+    ASSERT_EQ(half_bits_to_float(float_to_half_bits(2051.f)), 2052.f);
+
+    // Subnormals
+    ASSERT_EQ(float_to_half_bits(std::ldexp(1.f, -24)), 1);
+    ASSERT_EQ(half_bits_to_float(0x0200), std::ldexp(1.f, -15));
+    ASSERT_EQ(float_to_half_bits(std::ldexp(1.f, -25)), 0);
+
+    // Bulk conversion agrees with the scalar one on every length
+    std::vector<float> values;
+    for (int i = 0; i < 13; i++) values.push_back(static_cast<float>(i) * 0.75f - 4.f);
+    std::vector<uint16_t> halves(values.size());
+    std::vector<float> back(values.size());
+    floats_to_halves(values.data(), halves.data(), values.size());
+    halves_to_floats(halves.data(), back.data(), values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_EQ(halves[i], float_to_half_bits(values[i]));
+        ASSERT_EQ(back[i], values[i]);
+    }
+}
+
+// ========== SIMD Dispatch Tests ==========
+
+// Outputs of every kernel on the same inputs, and of a Box layout using them
+struct KernelResults {
+    std::vector<float> edges;
+    std::vector<float> offsets;
+    std::vector<float> sizes;
+    std::vector<Rect> rects;
+    std::vector<Rect> bounds;
+    std::vector<uint16_t> halves;
+    std::vector<float> floats;
+};
+
+static KernelResults run_kernels() {
+    // 37 items exercises the vector loops and the scalar tails of every width
+    const size_t count = 37;
+    std::vector<float> in[12];
+    for (size_t f = 0; f < 12; f++) {
+        for (size_t i = 0; i < count; i++) in[f].push_back(std::sin(static_cast<float>(f * count + i)) * 0.5f + 0.5f);
+    }
+    for (size_t i = 0; i < count; i++) {
+        in[10][i] *= 300.f; // frame widths
+        in[11][i] *= 200.f; // frame heights
+    }
+
+    AnchorSpans spans;
+    spans.count = count;
+    spans.anchor_left = in[0].data();
+    spans.anchor_top = in[1].data();
+    spans.anchor_right = in[2].data();
+    spans.anchor_bottom = in[3].data();
+    spans.offset_left = in[4].data();
+    spans.offset_top = in[5].data();
+    spans.offset_right = in[6].data();
+    spans.offset_bottom = in[7].data();
+    spans.frame_x = in[8].data();
+    spans.frame_y = in[9].data();
+    spans.frame_width = in[10].data();
+    spans.frame_height = in[11].data();
+
+    KernelResults r;
+    r.edges.resize(count * 8);
+    for (int mirrored = 0; mirrored < 2; mirrored++) {
+        float *e = r.edges.data() + mirrored * count * 4;
+        resolve_anchor_spans(spans, mirrored != 0, {e, e + count, e + count * 2, e + count * 3});
+    }
+
+    // Every third item doesn't expand
+    std::vector<float> weights(in[0]);
+    float total_weight = 0.f;
+    for (size_t i = 0; i < count; i += 3) weights[i] = 0.f;
+    for (float w: weights) total_weight += w;
+    r.offsets.resize(count);
+    r.sizes.resize(count);
+    distribute_spans(in[10].data(), weights.data(), count, 123.4f, total_weight, 7.f, 0.3f, r.offsets.data(),
+                     r.sizes.data());
+
+    for (size_t i = 0; i < count; i++) r.rects.push_back({{in[8][i] * 50.f, in[9][i]}, {in[10][i], in[11][i]}});
+    translate_rects(r.rects.data(), count, 3.25f, -1.5f);
+    mirror_rects(r.rects.data(), count, 10.f, 333.3f);
+
+    // Halves from subnormal to overflowing, ties and special values, then every bit pattern back
+    using limits = std::numeric_limits<float>;
+    std::vector<float> values = {65520.f, 2049.f, 2051.f, -0.f, std::ldexp(1.f, -25), std::ldexp(3.f, -26),
+                                 limits::infinity(), -limits::infinity(), limits::quiet_NaN(), limits::signaling_NaN()};
+    for (size_t i = 0; i < count * 4; i++)
+        values.push_back(std::ldexp(in[i % 12][i / 12] - 0.5f, static_cast<int>(i % 45) - 28));
+    r.halves.resize(values.size());
+    floats_to_halves(values.data(), r.halves.data(), values.size());
+    std::vector<uint16_t> patterns(65536);
+    for (size_t i = 0; i < patterns.size(); i++) patterns[i] = static_cast<uint16_t>(i);
+    r.floats.resize(patterns.size());
+    halves_to_floats(patterns.data(), r.floats.data(), patterns.size());
+
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::SpaceBetween});
+    get_node(&sys, root)->bounds = {{1.5f, 0}, {5000.f, 40.f}};
+    std::vector<NodeId> children;
+    for (size_t i = 0; i < 23; i++) {
+        NodeId child = add_generic(&sys, root);
+        Node *c = get_node(&sys, child);
+        c->minimum_size = {in[10][i], 20.f};
+        c->expand = {i % 4 ? 1.f : 0.f, 0.f};
+        c->stretch = {in[0][i] + 0.1f, 1.f};
+        children.push_back(child);
+    }
+    compute_layout(&sys, root);
+    for (NodeId child: children) r.bounds.push_back(get_node(&sys, child)->bounds);
+    return r;
+}
+
+template<typename T>
+static bool same_bits(const std::vector<T> &a, const std::vector<T> &b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+TEST(simd_variants_match_scalar) {
+    const Isa detected = detected_isa();
+    ASSERT_EQ(active_isa(), detected);
+    ASSERT_TRUE(force_isa(Isa::Scalar));
+    ASSERT_EQ(active_isa(), Isa::Scalar);
+    const KernelResults scalar = run_kernels();
+
+    // Spot checks against the scalar formulas
+    const Rect &first = scalar.bounds[0];
+    ASSERT_NEAR(first.origin.x, 1.5f, 0.001f);
+    Rect rect{{10, 0}, {20, 5}};
+    translate_rects(&rect, 1, 5.f, 2.f);
+    mirror_rects(&rect, 1, 0.f, 100.f);
+    ASSERT_EQ(rect.origin.x, 65.f);
+    ASSERT_EQ(rect.origin.y, 2.f);
+
+    for (Isa isa: {Isa::Sse4, Isa::Avx2, Isa::Avx512, Isa::Avx512Fp16}) {
+        if (!force_isa(isa)) {
+            std::cout << "  " << isa_name(isa) << " not supported, skipped" << std::endl;
+            continue;
+        }
+        ASSERT_EQ(active_isa(), isa);
+        const KernelResults r = run_kernels();
+        ASSERT_TRUE(same_bits(r.edges, scalar.edges));
+        ASSERT_TRUE(same_bits(r.offsets, scalar.offsets));
+        ASSERT_TRUE(same_bits(r.sizes, scalar.sizes));
+        ASSERT_TRUE(same_bits(r.rects, scalar.rects));
+        ASSERT_TRUE(same_bits(r.bounds, scalar.bounds));
+        ASSERT_TRUE(same_bits(r.halves, scalar.halves));
+        ASSERT_TRUE(same_bits(r.floats, scalar.floats));
+    }
+
+    force_isa(detected);
+}
+
+// ========== Span Kernel Tests ==========
+
+// Items shared by the kernel tests, children get the same inputs
+static const float2 span_sizes[] = {{20, 10}, {30, 15}, {10, 5}, {25, 20}};
+static const float2 span_expand[] = {{0, 0}, {1, 1}, {1, 0}, {0, 1}};
+static const float2 span_stretch[] = {{1, 1}, {2, 1}, {1, 1}, {1, 1}};
+static const Rect span_frame{{5, 7}, {90, 40}};
+
+static ItemSpans span_items() {
+    ItemSpans items;
+    items.count = 4;
+    items.sizes = span_sizes;
+    items.expand = span_expand;
+    items.stretch = span_stretch;
+    return items;
+}
+
+// Lay out the root at span_frame and compare its children with the kernel rects
+static bool children_match(System *sys, NodeId root, bool mirrored, const Rect *expected) {
+    set_mirror_x(sys, root, mirrored);
+    get_node(sys, root)->bounds = span_frame;
+    compute_layout(sys, root);
+    const Node *node = get_node(sys, root);
+    for (size_t i = 0; i < node->children.size(); i++) {
+        const Rect &bounds = get_node(sys, node->children[i])->bounds;
+        if (std::abs(bounds.origin.x - expected[i].origin.x) > 0.001f ||
+            std::abs(bounds.origin.y - expected[i].origin.y) > 0.001f ||
+            std::abs(bounds.size.x - expected[i].size.x) > 0.001f ||
+            std::abs(bounds.size.y - expected[i].size.y) > 0.001f)
+            return false;
+    }
+    return true;
+}
+
+static void add_span_children(System *sys, NodeId root) {
+    for (size_t i = 0; i < 4; i++) {
+        Node *child = get_node(sys, add_generic(sys, root));
+        child->minimum_size = span_sizes[i];
+        child->expand = span_expand[i];
+        child->stretch = span_stretch[i];
+    }
+}
+
+TEST(span_kernels_match_system_layouts) {
+    const ItemSpans items = span_items();
+    Rect rects[4];
+
+    for (int mirrored = 0; mirrored < 2; mirrored++) {
+        for (Align align: {Align::Start, Align::SpaceBetween}) {
+            const BoxData row{Direction::Horizontal, align};
+            System box;
+            NodeId box_root = add_box(&box, NullNode, row);
+            add_span_children(&box, box_root);
+            box_kernel(items, span_frame, row, mirrored != 0, rects);
+            ASSERT_TRUE(children_match(&box, box_root, mirrored != 0, rects));
+        }
+
+        const FlowData flow_data{Direction::Horizontal, Align::Start};
+        System flow;
+        NodeId flow_root = add_flow(&flow, NullNode, flow_data);
+        add_span_children(&flow, flow_root);
+        flow_kernel(items, span_frame, flow_data, mirrored != 0, rects);
+        ASSERT_TRUE(children_match(&flow, flow_root, mirrored != 0, rects));
+
+        const MarginData margin_data{3, 8, 2, 4};
+        System margin;
+        NodeId margin_root = add_margin(&margin, NullNode, margin_data);
+        add_span_children(&margin, margin_root);
+        margin_kernel(items, span_frame, margin_data, mirrored != 0, rects);
+        ASSERT_TRUE(children_match(&margin, margin_root, mirrored != 0, rects));
+
+        System center;
+        NodeId center_root = add_center(&center, NullNode);
+        add_span_children(&center, center_root);
+        center_kernel(items, span_frame, rects);
+        ASSERT_TRUE(children_match(&center, center_root, mirrored != 0, rects));
+    }
+
+    // Spot checks: the 60 leftover splits 2:1 between the expanding items, the flow wraps
+    // before the fourth item and the mirrored margin puts the left inset on the right
+    box_kernel(items, {{0, 0}, {145, 40}}, {Direction::Horizontal, Align::Start}, false, rects);
+    ASSERT_NEAR(rects[1].size.x, 70.f, 0.001f);
+    ASSERT_NEAR(rects[2].origin.x, 90.f, 0.001f);
+    flow_kernel(items, {{5, 7}, {70, 40}}, {Direction::Horizontal, Align::Start}, false, rects);
+    ASSERT_NEAR(rects[3].origin.x, 5.f, 0.001f);
+    ASSERT_NEAR(rects[3].origin.y, 47.f, 0.001f);
+    margin_kernel(items, span_frame, {3, 8, 2, 4}, true, rects);
+    ASSERT_NEAR(rects[0].origin.x + rects[0].size.x, 92.f, 0.001f);
+}
+
+TEST(box_kernel_matches_layout_box) {
+    // 13 items covers the vector loops and tails of the distribution, every input is exact as a half
+    std::vector<float2> sizes, expand, stretch;
+    for (int i = 0; i < 13; i++) {
+        sizes.push_back({7.5f + static_cast<float>(i * 3 % 11), 4.25f + static_cast<float>(i * 5 % 7)});
+        expand.push_back({static_cast<float>(i % 3 != 0), static_cast<float>(i % 4 == 1)});
+        stretch.push_back({1.f + static_cast<float>(i % 5) * 0.25f, 1.f + static_cast<float>(i % 2)});
+    }
+    ItemSpans items;
+    items.count = sizes.size();
+    items.sizes = sizes.data();
+    items.expand = expand.data();
+    items.stretch = stretch.data();
+    const Rect frame{{3.5f, 2.f}, {517.3f, 311.1f}};
+
+    for (Direction direction: {Direction::Horizontal, Direction::Vertical}) {
+        for (Align align: {Align::Start, Align::Center, Align::End, Align::SpaceBetween}) {
+            for (int mirrored = 0; mirrored < 2; mirrored++) {
+                const BoxData data{direction, align};
+                System sys;
+                NodeId root = add_box(&sys, NullNode, data);
+                for (size_t i = 0; i < sizes.size(); i++) {
+                    Node *child = get_node(&sys, add_generic(&sys, root));
+                    child->minimum_size = sizes[i];
+                    child->expand = expand[i];
+                    child->stretch = stretch[i];
+                }
+                set_mirror_x(&sys, root, mirrored != 0);
+                get_node(&sys, root)->bounds = frame;
+                compute_layout(&sys, root);
+                std::vector<Rect> laid_out;
+                for (NodeId child: get_node(&sys, root)->children) laid_out.push_back(get_node(&sys, child)->bounds);
+
+                // Both forms of the kernel give the System's rects to the bit
+                std::vector<Rect> rects(sizes.size());
+                box_kernel(items, frame, data, mirrored != 0, rects.data());
+                ASSERT_TRUE(same_bits(rects, laid_out));
+                std::vector<Rect> placed(sizes.size());
+                size_t calls = 0;
+                box_kernel(items, frame, data, mirrored != 0, [&](size_t i, const Rect &rect) {
+                    ASSERT_EQ(i, calls++);
+                    placed[i] = rect;
+                });
+                ASSERT_EQ(calls, sizes.size());
+                ASSERT_TRUE(same_bits(placed, laid_out));
+            }
+        }
+    }
+}
+
+TEST(anchor_kernel_matches_system_layout) {
+    const float anchors[4] = {0.25f, 0.f, 0.75f, 0.5f};
+    const float offsets[4] = {2.f, 1.f, -2.f, 0.f};
+    const float frame[4] = {span_frame.origin.x, span_frame.origin.y, span_frame.size.x, span_frame.size.y};
+
+    AnchorSpans in;
+    in.count = 1;
+    in.anchor_left = &anchors[0];
+    in.anchor_top = &anchors[1];
+    in.anchor_right = &anchors[2];
+    in.anchor_bottom = &anchors[3];
+    in.offset_left = &offsets[0];
+    in.offset_top = &offsets[1];
+    in.offset_right = &offsets[2];
+    in.offset_bottom = &offsets[3];
+    in.frame_x = &frame[0];
+    in.frame_y = &frame[1];
+    in.frame_width = &frame[2];
+    in.frame_height = &frame[3];
+
+    for (int mirrored = 0; mirrored < 2; mirrored++) {
+        System sys;
+        NodeId root = add_generic(&sys, NullNode);
+        Node *child = get_node(&sys, add_generic(&sys, root));
+        child->anchors = {anchors[0], anchors[1], anchors[2], anchors[3]};
+        child->offsets = {offsets[0], offsets[1], offsets[2], offsets[3]};
+
+        // Both axes span a nonzero extent, so the starting rect is fully replaced
+        Rect rect{};
+        anchor_kernel(in, mirrored != 0, &rect);
+        ASSERT_TRUE(children_match(&sys, root, mirrored != 0, &rect));
+        if (!mirrored) {
+            ASSERT_NEAR(rect.origin.x, 29.5f, 0.001f);
+            ASSERT_NEAR(rect.size.x, 45.f, 0.001f); // Offsets inset the right edge
+        }
+    }
+}
+
+// ========== Layout Cache Tests ==========
+
+// The same menu on every call, like a host building its UI at startup
+static NodeId build_menu(System *sys, float width) {
+    NodeId root = add_box(sys, NullNode, {Direction::Vertical, Align::Start});
+    get_node(sys, root)->bounds = {{0, 0}, {width, 400}};
+
+    NodeId header = add_margin(sys, root, {8, 8, 4, 4});
+    get_node(sys, header)->minimum_size = {0, 40};
+    NodeId title = add_generic(sys, header);
+    get_node(sys, title)->minimum_size = {120, 20};
+    get_node(sys, title)->anchors = {0.f, 0.f, 1.f, 0.f};
+
+    NodeId items = add_flow(sys, root, {Direction::Horizontal, Align::Start});
+    add_flow_breakpoint(sys, items, 0.f, 300.f, {Direction::Vertical, Align::Start});
+    for (int i = 0; i < 6; i++) get_node(sys, add_generic(sys, items))->minimum_size = {90, 30};
+
+    NodeId pages = add_stack(sys, root);
+    get_node(sys, pages)->expand = {1, 1};
+    NodeId grid = add_masonry(sys, pages, {3, 4.f});
+    for (int i = 0; i < 5; i++) get_node(sys, add_generic(sys, grid))->minimum_size = {0, 20.f + i * 7.f};
+    get_node(sys, add_center(sys, pages))->minimum_size = {50, 50};
+    return root;
+}
+
+static bool same_results(const System &a, const System &b) {
+    if (a.nodes.size() != b.nodes.size()) return false;
+    for (size_t i = 0; i < a.nodes.size(); i++) {
+        const Node &x = a.nodes[i];
+        const Node &y = b.nodes[i];
+        if (std::memcmp(&x.bounds, &y.bounds, sizeof(Rect)) != 0 ||
+            std::memcmp(&x.content_extent, &y.content_extent, sizeof(Rect)) != 0 || x.overflow != y.overflow)
+            return false;
+    }
+    return true;
+}
+
+TEST(layout_cache_restores_results_between_runs) {
+    const char *path = "frameflow_layout_cache_test.bin";
+
+    // First launch solves and saves
+    System first;
+    NodeId first_root = build_menu(&first, 640);
+    LayoutCache cache;
+    ASSERT_FALSE(compute_layout_cached(&first, first_root, &cache));
+    ASSERT_EQ(cache.entries.size(), 1u);
+    ASSERT_TRUE(cache.modified);
+    ASSERT_TRUE(save_layout_cache(&cache, path));
+    ASSERT_FALSE(cache.modified);
+
+    // Next launch fills the same results from the file without solving
+    System second;
+    NodeId second_root = build_menu(&second, 640);
+    ASSERT_EQ(layout_cache_key(&second, second_root), cache.entries[0].key);
+    LayoutCache loaded;
+    ASSERT_TRUE(load_layout_cache(&loaded, path));
+    ASSERT_EQ(loaded.entries.size(), 1u);
+    ASSERT_TRUE(compute_layout_cached(&second, second_root, &loaded));
+    ASSERT_TRUE(same_results(first, second));
+    ASSERT_TRUE(get_node(&second, second_root)->layout_clean);
+
+    // Appending to the masonry after a hit places from empty columns, like a full relayout
+    NodeId extra = add_generic(&second, get_node(&second, second_root)->children[2]);
+    ASSERT_TRUE(is_valid(&second, extra));
+    System check;
+    NodeId check_root = build_menu(&check, 640);
+    add_generic(&check, get_node(&check, check_root)->children[2]);
+    compute_layout(&second, second_root);
+    compute_layout(&check, check_root);
+    ASSERT_TRUE(same_results(second, check));
+
+    // Another root rect (crossing the Flow breakpoint) misses and adds an entry
+    System narrow;
+    NodeId narrow_root = build_menu(&narrow, 280);
+    ASSERT_FALSE(compute_layout_cached(&narrow, narrow_root, &loaded));
+    ASSERT_EQ(loaded.entries.size(), 2u);
+    System narrow_check;
+    NodeId narrow_check_root = build_menu(&narrow_check, 280);
+    ASSERT_TRUE(compute_layout_cached(&narrow_check, narrow_check_root, &loaded));
+    ASSERT_TRUE(same_results(narrow, narrow_check));
+
+    // Capacity drops the oldest entry
+    loaded.capacity = 1;
+    System wide;
+    ASSERT_FALSE(compute_layout_cached(&wide, build_menu(&wide, 900), &loaded));
+    ASSERT_EQ(loaded.entries.size(), 1u);
+
+    // Truncated files and missing ones leave the cache empty
+    std::FILE *file = std::fopen(path, "r+b");
+    ASSERT_TRUE(file != nullptr);
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fclose(file);
+    std::vector<char> bytes(static_cast<size_t>(size));
+    file = std::fopen(path, "rb");
+    ASSERT_EQ(std::fread(bytes.data(), 1, bytes.size(), file), bytes.size());
+    std::fclose(file);
+    file = std::fopen(path, "wb");
+    std::fwrite(bytes.data(), 1, bytes.size() - 5, file);
+    std::fclose(file);
+    ASSERT_FALSE(load_layout_cache(&loaded, path));
+    ASSERT_TRUE(loaded.entries.empty());
+
+    std::remove(path);
+    ASSERT_FALSE(load_layout_cache(&loaded, path));
+    ASSERT_FALSE(compute_layout_cached(&first, NullNode, &loaded));
+}
+
+TEST(layout_cache_rejects_mismatched_entries) {
+    const char *path = "frameflow_layout_cache_mismatch_test.bin";
+
+    // A file whose entry has the key of a menu with one more Flow item, as a hash collision would
+    System first;
+    NodeId first_root = build_menu(&first, 640);
+    LayoutCache cache;
+    ASSERT_FALSE(compute_layout_cached(&first, first_root, &cache));
+    System longer;
+    NodeId longer_root = build_menu(&longer, 640);
+    add_generic(&longer, get_node(&longer, longer_root)->children[1]);
+    cache.entries[0].key = layout_cache_key(&longer, longer_root);
+    ASSERT_TRUE(save_layout_cache(&cache, path));
+
+    // The entry runs out before the last node, the menu is solved and the entry replaced
+    LayoutCache loaded;
+    ASSERT_TRUE(load_layout_cache(&loaded, path));
+    ASSERT_FALSE(compute_layout_cached(&longer, longer_root, &loaded));
+    System longer_check;
+    NodeId longer_check_root = build_menu(&longer_check, 640);
+    add_generic(&longer_check, get_node(&longer_check, longer_check_root)->children[1]);
+    compute_layout(&longer_check, longer_check_root);
+    ASSERT_TRUE(same_results(longer, longer_check));
+    ASSERT_EQ(loaded.entries.size(), 1u);
+    ASSERT_EQ(loaded.entries[0].bounds.size(), cache.entries[0].bounds.size() + 1);
+
+    // An entry with results left over doesn't match a smaller menu either
+    System shorter;
+    NodeId shorter_root = build_menu(&shorter, 640);
+    loaded.entries[0].key = layout_cache_key(&shorter, shorter_root);
+    ASSERT_FALSE(compute_layout_cached(&shorter, shorter_root, &loaded));
+    ASSERT_TRUE(same_results(shorter, first));
+
+    // Nor one whose content extents don't line up with its bounds
+    System uneven;
+    NodeId uneven_root = build_menu(&uneven, 640);
+    loaded.entries[0].key = layout_cache_key(&uneven, uneven_root);
+    loaded.entries[0].content_extents.pop_back();
+    ASSERT_FALSE(compute_layout_cached(&uneven, uneven_root, &loaded));
+    ASSERT_TRUE(same_results(uneven, first));
+
+    // A file cut inside the results of an entry doesn't load
+    std::vector<char> bytes;
+    std::FILE *file = std::fopen(path, "rb");
+    ASSERT_TRUE(file != nullptr);
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) bytes.push_back(static_cast<char>(c));
+    std::fclose(file);
+    file = std::fopen(path, "wb");
+    std::fwrite(bytes.data(), 1, bytes.size() / 2, file);
+    std::fclose(file);
+    ASSERT_FALSE(load_layout_cache(&loaded, path));
+    ASSERT_TRUE(loaded.entries.empty());
+    std::remove(path);
+}
+
+// ========== Embed Tests ==========
+
+TEST(embed_is_a_leaf_of_the_outer_layout) {
+    System chat;
+    NodeId messages = add_margin(&chat, NullNode, {4, 4, 4, 4});
+    NodeId list = add_box(&chat, messages, {Direction::Vertical, Align::Start});
+    get_node(&chat, list)->expand = {1, 1};
+    NodeId first = add_generic(&chat, list);
+    get_node(&chat, first)->minimum_size = {0, 30};
+    get_node(&chat, first)->expand = {1, 0};
+
+    System screen;
+    NodeId root = add_box(&screen, NullNode, {Direction::Horizontal, Align::Start});
+    get_node(&screen, root)->bounds = {{10, 20}, {400, 300}};
+    NodeId sidebar = add_generic(&screen, root);
+    get_node(&screen, sidebar)->minimum_size = {100, 300};
+    EmbedId embed = add_embed(&screen, root, {&chat, messages});
+    ASSERT_TRUE(is_valid(&screen, embed));
+    get_node(&screen, embed)->minimum_size = {50, 300};
+    get_node(&screen, embed)->expand = {1, 0};
+    NodeId stray = add_generic(&screen, embed); // Not laid out
+    get_node(&screen, stray)->minimum_size = {10, 10};
+
+    compute_layout(&screen, root);
+    const Rect placed = get_node(&screen, embed)->bounds;
+    ASSERT_NEAR(placed.origin.x, 110.f, 0.001f);
+    ASSERT_NEAR(placed.size.x, 300.f, 0.001f);
+    ASSERT_EQ(get_node(&screen, stray)->bounds.size.x, 0.f);
+    ASSERT_EQ(get_active_type(&screen, embed), NodeType::Embed);
+
+    // The inner root gets the size, in its own coordinates
+    ASSERT_TRUE(sync_embed(&screen, embed));
+    ASSERT_FALSE(sync_embed(&screen, embed));
+    ASSERT_EQ(get_node(&chat, messages)->bounds.origin.x, 0.f);
+    ASSERT_NEAR(get_node(&chat, messages)->bounds.size.x, 300.f, 0.001f);
+    compute_layout(&chat, messages);
+    ASSERT_NEAR(get_node(&chat, list)->bounds.size.x, 292.f, 0.001f);
+
+    // Churn inside leaves the outer tree clean, and the two lay out on separate threads
+    for (int i = 0; i < 20; i++) get_node(&chat, add_generic(&chat, list))->minimum_size = {0, 12};
+    ASSERT_TRUE(get_node(&screen, root)->layout_clean);
+    get_node(&screen, sidebar)->minimum_size = {150, 300};
+    invalidate_layout(&screen, sidebar);
+    std::thread inner([&chat, messages] { compute_layout(&chat, messages); });
+    compute_layout(&screen, root);
+    inner.join();
+    const Node *list_node = get_node(&chat, list);
+    ASSERT_NEAR(get_node(&chat, list_node->children.back())->bounds.origin.y, 4.f + 30.f + 19 * 12.f, 0.001f);
+
+    // The outer resize reaches the inner root through the next sync
+    ASSERT_NEAR(get_node(&screen, embed)->bounds.size.x, 250.f, 0.001f);
+    ASSERT_TRUE(sync_embed(&screen, embed));
+    ASSERT_NEAR(get_node(&chat, messages)->bounds.size.x, 250.f, 0.001f);
+
+    // Data without a System or with a deleted root syncs nothing
+    ASSERT_TRUE(set_embed_data(&screen, embed, {&chat, first}));
+    ASSERT_EQ(get_embed_data(&screen, embed)->root, first);
+    delete_node(&chat, first);
+    ASSERT_FALSE(sync_embed(&screen, embed));
+    ASSERT_TRUE(set_embed_data(&screen, embed, {}));
+    ASSERT_FALSE(sync_embed(&screen, embed));
+    ASSERT_TRUE(delete_node(&screen, embed));
+    ASSERT_EQ(get_embed_data(&screen, embed), nullptr);
+    ASSERT_TRUE(is_valid(&chat, messages)); // The inner System isn't owned
+}
+
+// ========== Complex Nested Tests ==========
+
+TEST(nested_box_in_center) {
+    System sys;
+    NodeId center = add_center(&sys, NullNode);
+    NodeId box = add_box(&sys, center, {Direction::Horizontal, Align::Start});
+    NodeId child1 = add_generic(&sys, box);
+    NodeId child2 = add_generic(&sys, box);
+    
+    Node* center_node = get_node(&sys, center);
+    center_node->bounds = {{0, 0}, {200, 200}};
+    
+    Node* box_node = get_node(&sys, box);
+    box_node->minimum_size = {100, 50};
+    
+    Node* c1 = get_node(&sys, child1);
+    c1->minimum_size = {40, 50};
+    
+    Node* c2 = get_node(&sys, child2);
+    c2->minimum_size = {60, 50};
+    
+    compute_layout(&sys, center);
+    
+    // Box should be centered
+    ASSERT_NEAR(box_node->bounds.origin.x, 50, 0.01);  // (200-100)/2
+    ASSERT_NEAR(box_node->bounds.origin.y, 75, 0.01);  // (200-50)/2
+    
+    // Children should be laid out horizontally within box
+    ASSERT_NEAR(c1->bounds.origin.x, 50, 0.01);
+    ASSERT_NEAR(c2->bounds.origin.x, 90, 0.01);
+}
+
+// ========== Edge Cases ==========
+
+TEST(empty_children_doesnt_crash) {
+    System sys;
+    NodeId root = add_box(&sys, NullNode, {Direction::Horizontal, Align::Start});
+    
+    Node* root_node = get_node(&sys, root);
+    root_node->bounds = {{0, 0}, {100, 100}};
+    
+    compute_layout(&sys, root);  // Should not crash
+}
+
+TEST(zero_size_parent) {
+    System sys;
+    NodeId root = add_generic(&sys, NullNode);
+    NodeId child = add_generic(&sys, root);
+    
+    Node* root_node = get_node(&sys, root);
+    root_node->bounds = {{0, 0}, {0, 0}};
+    
+    Node* child_node = get_node(&sys, child);
+    child_node->expand = {1, 1};
+    
+    compute_layout(&sys, root);
+    
+    // Should not crash, child should be 0 size
+    ASSERT_NEAR(child_node->bounds.size.x, 0, 0.01);
+    ASSERT_NEAR(child_node->bounds.size.y, 0, 0.01);
+}
+
+// ========== Main ==========
+
+int main() {
+    // Basic tests
+    RUN_TEST(node_creation);
+    RUN_TEST(node_hierarchy);
+    RUN_TEST(invalid_parent_returns_null);
+    
+    // Deletion tests
+    RUN_TEST(delete_node_basic);
+    RUN_TEST(delete_node_with_children);
+    RUN_TEST(node_reuse_after_deletion);
+    
+    // Reparenting tests
+    RUN_TEST(reparent_basic);
+    RUN_TEST(reparent_prevents_cycles);
+    RUN_TEST(reparent_to_self_fails);
+    RUN_TEST(transfer_subtree_between_systems);
+    
+    // Generic layout
+    RUN_TEST(generic_respects_minimum_size);
+    RUN_TEST(generic_expand_fills_parent);
+    
+    // Anchors
+    RUN_TEST(anchors_full_fill);
+    RUN_TEST(anchors_centered_quarter);
+    RUN_TEST(anchors_with_offsets);
+    
+    // Center layout
+    RUN_TEST(center_centers_child);
+    RUN_TEST(center_percent_size);
+    
+    // Box layout
+    RUN_TEST(box_horizontal_basic);
+    RUN_TEST(box_horizontal_expand_stretch);
+    RUN_TEST(box_horizontal_align_center);
+    RUN_TEST(box_horizontal_align_end);
+    RUN_TEST(box_horizontal_space_between);
+    RUN_TEST(box_vertical_basic);
+    RUN_TEST(box_percent_and_aspect_ratio);
+
+    // Indexed Box
+    RUN_TEST(indexed_box_queries_match_layout);
+    RUN_TEST(indexed_box_alignment_and_structure_changes);
+    
+    // Flow layout
+    RUN_TEST(flow_horizontal_no_wrap);
+    RUN_TEST(flow_horizontal_with_wrap);
+    RUN_TEST(wrapping_content_follows_structure_changes);
+    RUN_TEST(flow_height_for_width_in_vertical_box);
+    RUN_TEST(height_for_width_through_margin);
+    
+    // Margin layout
+    RUN_TEST(margin_insets_children);
+    RUN_TEST(margin_asymmetric);
+    RUN_TEST(margin_percent_uses_inner_size);
+    
+    // Typed handles
+    RUN_TEST(set_component_data_relays_out_container);
+
+    // Content extent
+    RUN_TEST(content_extent_and_overflow);
+
+    // User flags
+    RUN_TEST(subtree_flags_follow_structure_changes);
+    RUN_TEST(hit_test_prunes_by_flags_and_extent);
+
+    // Breakpoints
+    RUN_TEST(breakpoint_switches_box_direction);
+    RUN_TEST(breakpoint_changes_node_type);
+    RUN_TEST(breakpoint_measured_at_the_new_width);
+    RUN_TEST(breakpoint_components_recycled_on_delete);
+
+    // Mirroring
+    RUN_TEST(mirror_x_solves_right_to_left);
+    RUN_TEST(set_mirror_x_matches_full_relayout);
+    RUN_TEST(set_mirror_x_translates_mirrored_descendants);
+
+    // Stack
+    RUN_TEST(stack_lays_out_only_active_page);
+    RUN_TEST(stack_page_resolved_when_inputs_change);
+
+    // Masonry
+    RUN_TEST(masonry_places_in_shortest_column);
+    RUN_TEST(masonry_resumes_after_append);
+    RUN_TEST(masonry_restarts_when_placed_heights_change);
+    RUN_TEST(masonry_append_skips_placed_children);
+
+    // Anchor targets
+    RUN_TEST(anchor_target_in_other_root);
+    RUN_TEST(anchor_target_cycle_detected);
+
+    // Shared layouts
+    RUN_TEST(shared_rows_match_solved_rows);
+    RUN_TEST(shared_layouts_keep_host_placed_children);
+    RUN_TEST(nested_shared_lists_match_plain_layout);
+
+    // Shadow validation
+    RUN_TEST(shadow_validation_agrees_with_fast_paths);
+    RUN_TEST(shadow_validation_reports_stale_fast_path);
+    RUN_TEST(shadow_validation_compares_content_extents);
+
+    // History
+    RUN_TEST(history_reconstructs_recorded_frames);
+
+    // Lazy evaluation
+    RUN_TEST(get_bounds_solves_only_the_path);
+    RUN_TEST(get_bounds_after_deep_wrapping_change);
+    RUN_TEST(get_bounds_after_structure_change);
+    RUN_TEST(get_bounds_follows_anchor_targets);
+    RUN_TEST(get_bounds_after_deleting_anchor_target);
+
+    // Layout tape
+    RUN_TEST(tape_matches_compute_layout);
+
+    // Streaming
+    RUN_TEST(streaming_publishes_final_subtrees_in_order);
+
+    // Compact inputs
+    RUN_TEST(half_conversion_rounds_to_nearest_even);
+
+    // SIMD dispatch
+    RUN_TEST(simd_variants_match_scalar);
+
+    // Span kernels
+    RUN_TEST(span_kernels_match_system_layouts);
+    RUN_TEST(box_kernel_matches_layout_box);
+    RUN_TEST(anchor_kernel_matches_system_layout);
+
+    // Layout cache
+    RUN_TEST(layout_cache_restores_results_between_runs);
+    RUN_TEST(layout_cache_rejects_mismatched_entries);
+
+    // Embed
+    RUN_TEST(embed_is_a_leaf_of_the_outer_layout);
 
-int main() {
-    // Basic tests
-    RUN_TEST(node_creation);
-    RUN_TEST(node_hierarchy);
-    RUN_TEST(invalid_parent_returns_null);
-    
-    // Deletion tests
-    RUN_TEST(delete_node_basic);
-    RUN_TEST(delete_node_with_children);
-    RUN_TEST(node_reuse_after_deletion);
-    
-    // Reparenting tests
-    RUN_TEST(reparent_basic);
-    RUN_TEST(reparent_prevents_cycles);
-    RUN_TEST(reparent_to_self_fails);
-    
-    // Generic layout
-    RUN_TEST(generic_respects_minimum_size);
-    RUN_TEST(generic_expand_fills_parent);
-    
-    // Anchors
-    RUN_TEST(anchors_full_fill);
-    RUN_TEST(anchors_centered_quarter);
-    RUN_TEST(anchors_with_offsets);
-    
-    // Center layout
-    RUN_TEST(center_centers_child);
-    
-    // Box layout
-    RUN_TEST(box_horizontal_basic);
-    RUN_TEST(box_horizontal_expand_stretch);
-    RUN_TEST(box_horizontal_align_center);
-    RUN_TEST(box_horizontal_align_end);
-    RUN_TEST(box_horizontal_space_between);
-    RUN_TEST(box_vertical_basic);
-    
-    // Flow layout
-    RUN_TEST(flow_horizontal_no_wrap);
-    RUN_TEST(flow_horizontal_with_wrap);
-    
-    // Margin layout
-    RUN_TEST(margin_insets_children);
-    RUN_TEST(margin_asymmetric);
-    
     // Complex cases
     RUN_TEST(nested_box_in_center);
     